@@ -57,7 +57,15 @@ namespace hp
         };
 
     public:
-        flist(): m_thread_index_calculator(0), m_head(nullptr) {}
+        flist():
+            m_head(nullptr),
+            m_registry(
+                [this] (uint64_t i) { m_hpm.thread_init(i); },
+                [this] (uint64_t i) { m_hpm.thread_release(i); }
+            )
+        {
+            m_head.store(m_hpm.get_node(0), std::memory_order_relaxed);
+        }
         ~flist()
         {
             auto ptr = m_head.load(std::memory_order_consume);
@@ -75,27 +83,23 @@ namespace hp
 
         uint64_t get_thread_index()
         {
-            thread_local static uint64_t thread_index =
-                m_thread_index_calculator.fetch_add(1, std::memory_order_acquire);
-            return thread_index;
+            return m_registry.get_thread_index();
         }
+        // optional, the slot is taken at the first call anyway
         void thread_init()
         {
-            if(m_thread_index_calculator.load(std::memory_order_acquire) >=
-               MAX_THREADS_NUMBER
-            ) throw std::runtime_error("Too many threads");
-            m_hpm.thread_init( get_thread_index() );
+            get_thread_index();
         }
+        // optional
         void init(
             uint64_t init_nodes_number = 0,
             uint64_t max_nodes_number = 0
         ) {
             m_hpm.init(
-                m_thread_index_calculator.load(std::memory_order_relaxed),
+                m_registry.get_threads_number(),
                 init_nodes_number,
                 max_nodes_number
             );
-            m_head.store(m_hpm.get_node(0), std::memory_order_relaxed);
         }
 
         bool contains(const value_type& val)
@@ -225,8 +229,10 @@ namespace hp
                     if(!cleared_next) return find_result{prev, nullptr};
                     curr = cleared_next;
                     m_hpm.set_hp(thread_index, 1, curr);
-                    if(curr != prev->next.load(std::memory_order_seq_cst))
-                        goto AGAIN;
+                    if(
+                        hp_manager_type::NEED_HP_VALIDATION &&
+                        curr != prev->next.load(std::memory_order_seq_cst)
+                    ) goto AGAIN;
                     next = curr->next.load(std::memory_order_relaxed);
                 }
                 if(curr->value >= val) return find_result{prev, curr};
@@ -235,17 +241,20 @@ namespace hp
                 m_hpm.set_hp(thread_index, 0, prev);
                 curr = next;
                 m_hpm.set_hp(thread_index, 1, curr);
-                if(curr != prev->next.load(std::memory_order_seq_cst)) goto AGAIN;
+                if(
+                    hp_manager_type::NEED_HP_VALIDATION &&
+                    curr != prev->next.load(std::memory_order_seq_cst)
+                ) goto AGAIN;
             }
             //
         }
 
     private:
-        std::atomic<uint64_t> m_thread_index_calculator;
         std::atomic<node_type*> m_head;
         char padding1[128 - sizeof m_head];
         hp_manager_type m_hpm;
         backoff_strategy_type m_backoff;
+        thread_registry<MAX_THREADS_NUMBER> m_registry;
     };
     //
 }
@@ -53,6 +53,8 @@ namespace hp
         std::atomic<hash_node*> next;
         value_type value;
         bool is_sentinel = false;
+        uint64_t birth_era = 0; // for ibr_manager
+        uint64_t retire_era = 0;
     };
 
     template<
@@ -85,7 +87,10 @@ namespace hp
         };
 
     public:
-        hash_flist(): m_head(nullptr) {}
+        hash_flist(): m_head(nullptr)
+        {
+            m_head.store(m_hpm.get_node(0), std::memory_order_relaxed);
+        }
         ~hash_flist()
         {
             auto ptr = m_head.load(std::memory_order_consume);
@@ -105,6 +110,10 @@ namespace hp
         {
             m_hpm.thread_init(thread_index);
         }
+        void thread_release(uint64_t thread_index)
+        {
+            m_hpm.thread_release(thread_index);
+        }
         void init(
             uint64_t threads_number,
             uint64_t init_nodes_number = 0,
@@ -115,7 +124,6 @@ namespace hp
                 init_nodes_number,
                 max_nodes_number
             );
-            m_head.store(m_hpm.get_node(0), std::memory_order_relaxed);
         }
 
 //        node_type* get_head()
@@ -291,8 +299,10 @@ namespace hp
                     if(!cleared_next) return find_result{prev, nullptr};
                     curr = cleared_next;
                     m_hpm.set_hp(thread_index, 1, curr);
-                    if(curr != prev->next.load(std::memory_order_seq_cst))
-                        goto AGAIN;
+                    if(
+                        hp_manager_type::NEED_HP_VALIDATION &&
+                        curr != prev->next.load(std::memory_order_seq_cst)
+                    ) goto AGAIN;
                     next = curr->next.load(std::memory_order_relaxed);
                 }
                 if(curr->is_sentinel) return find_result{prev, curr};
@@ -305,7 +315,10 @@ namespace hp
                 m_hpm.set_hp(thread_index, 0, prev);
                 curr = next;
                 m_hpm.set_hp(thread_index, 1, curr);
-                if(curr != prev->next.load(std::memory_order_seq_cst)) goto AGAIN;
+                if(
+                    hp_manager_type::NEED_HP_VALIDATION &&
+                    curr != prev->next.load(std::memory_order_seq_cst)
+                ) goto AGAIN;
             }
             //
         }
@@ -325,6 +338,12 @@ namespace hp
         typename BackOff = empty_backoff,
         typename Hash = std::hash<T>,
         typename Allocator = std::allocator<T>,
+        typename HpManager = hp_manager<
+            MaxThreadsNumber,
+            hash_node<T>,
+            Allocator,
+            BackOff
+        >,
         typename Tag = void // for creating different objects of the same T
     > class static_closed_hash_set: boost::noncopyable
     {
@@ -371,12 +390,7 @@ namespace hp
             T,
             compare_type,
             BackOff,
-            hp_manager<
-                MaxThreadsNumber,
-                hash_node<T>,
-                Allocator,
-                BackOff
-            >
+            HpManager
         >;
         using value_type = T;
         using node_type = typename hash_flist_type::node_type;
@@ -398,40 +412,41 @@ namespace hp
     public:
         static_closed_hash_set(float load_factor = 2):
             m_load_factor(load_factor),
-            m_thread_index_calculator(0),
-            m_ptrs( std::make_unique<data_type>() )
-        {}
+            m_ptrs( std::make_unique<data_type>() ),
+            m_registry(
+                [this] (uint64_t i) { m_data.thread_init(i); },
+                [this] (uint64_t i) { m_data.thread_release(i); }
+            )
+        {
+            auto& ptrs = *m_ptrs;
+            node_type* start_node = nullptr;
+            for(uint64_t i = 0; i < SIZE; ++i)
+            {
+                start_node = m_data.add_sentinel(i, start_node);
+                ptrs[i] = start_node;
+            }
+        }
         ~static_closed_hash_set() = default;
 
         uint64_t get_thread_index()
         {
-            thread_local static uint64_t thread_index =
-                m_thread_index_calculator.fetch_add(1, std::memory_order_acquire);
-            return thread_index;
+            return m_registry.get_thread_index();
         }
+        // optional, the slot is taken at the first call anyway
         void thread_init()
         {
-            if(m_thread_index_calculator.load(std::memory_order_acquire) >=
-               MAX_THREADS_NUMBER
-            ) throw std::runtime_error("Too many threads");
-            m_data.thread_init( get_thread_index() );
+            get_thread_index();
         }
+        // optional
         void init(
             uint64_t init_nodes_number = 0,
             uint64_t max_nodes_number = 0
         ) {
             m_data.init(
-                m_thread_index_calculator.load(std::memory_order_relaxed),
+                m_registry.get_threads_number(),
                 init_nodes_number,
                 max_nodes_number
             );
-            auto& ptrs = *m_ptrs;
-            node_type* start_node = nullptr;
-            for(uint64_t i = 0; i < SIZE; ++i)
-            {
-                start_node = m_data.add_sentinel(i, start_node);
-                ptrs[i] = start_node;
-            }
         }
 
         bool add(const value_type& value)
@@ -468,10 +483,10 @@ namespace hp
     private:
         float m_load_factor = 0;
         load_factor_controller_type m_load_factor_controller;
-        std::atomic<uint64_t> m_thread_index_calculator;
         std::unique_ptr<data_type> m_ptrs;
         hash_flist_type m_data;
         hash_type m_hash;
+        thread_registry<MAX_THREADS_NUMBER> m_registry;
     };
     //
 }
@@ -0,0 +1,461 @@
+#ifndef __HAZARD_POINTERS_PRIORITY_QUEUE_HPP__
+#define __HAZARD_POINTERS_PRIORITY_QUEUE_HPP__
+
+#include <cstdint>
+
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+
+#include <boost/noncopyable.hpp>
+
+#include "../technical.hpp"
+
+
+
+namespace lock_free
+{
+namespace hp
+{
+    // the tower of a skiplist node, the level 0 link is next
+    template <typename Priority, typename T, uint64_t MaxLevel = 16>
+    struct skiplist_node
+    {
+        static constexpr uint64_t MAX_LEVEL = MaxLevel;
+
+        using priority_type = Priority;
+        using value_type = T;
+
+        skiplist_node(): next(nullptr), links(0)
+        {
+            for(auto& ref : upper) ref.store(nullptr, std::memory_order_relaxed);
+        }
+
+        std::atomic<skiplist_node*>& get_next(uint64_t level)
+        {
+            return level ? upper[level - 1] : next;
+        }
+
+        // also links the free nodes inside hp_manager
+        std::atomic<skiplist_node*> next;
+        std::array<std::atomic<skiplist_node*>, MAX_LEVEL - 1> upper;
+        // the levels the node is linked at, plus one while push links it;
+        // the thread that drops it to zero retires the node
+        std::atomic<uint64_t> links;
+        uint64_t height = 1;
+        priority_type priority{};
+        value_type value{};
+        uint64_t birth_era = 0; // for ibr_manager
+        uint64_t retire_era = 0;
+    };
+
+    // lock-free skiplist priority queue, the smallest priority goes out
+    // first; a marked next at a level means the node is deleted there,
+    // the levels are marked from the top and the level 0 mark is the
+    // claim of pop_min; with Spread > 1 pop_min takes a random one of
+    // the first Spread nodes to spread the CAS over them
+    template<
+        uint64_t MaxThreadsNumber,
+        typename Priority,
+        typename T,
+        uint64_t MaxLevel = 16,
+        uint64_t Spread = 1, // or about the number of the popping threads
+        typename HpManager = hp_manager<
+            MaxThreadsNumber,
+            skiplist_node<Priority, T, MaxLevel>,
+            std::allocator<T>,
+            wait_backoff
+        >,
+        typename Tag = void // for creating different objects of the same T
+    > class priority_queue: boost::noncopyable
+    {
+    public:
+        static_assert(
+            std::is_trivially_copyable<Priority>::value,
+            "Priority must be trivially copyable"
+        );
+        static_assert(
+            std::is_trivially_copyable<T>::value,
+            "T must be trivially copyable"
+        );
+        static_assert(MaxLevel >= 1, "at least one level is needed");
+        static_assert(Spread >= 1, "Spread can't be zero");
+
+        static constexpr uint64_t MAX_THREADS_NUMBER = MaxThreadsNumber;
+        static constexpr uint64_t MAX_LEVEL = MaxLevel;
+        static constexpr uint64_t SPREAD = Spread;
+        static constexpr uint64_t REMOVED_MARK = 0x1;
+
+        using priority_type = Priority;
+        using value_type = T;
+        using hp_manager_type = HpManager;
+        using node_type = typename hp_manager_type::node_type;
+        using allocator_type = typename hp_manager_type::allocator_type;
+        using backoff_strategy_type =
+            typename hp_manager_type::backoff_strategy_type;
+
+        struct find_result
+        {
+            node_type* pred = nullptr;
+            node_type* succ = nullptr;
+        };
+        struct perthread_data_type
+        {
+            uint64_t random = 1;
+            char padding[128 - sizeof random];
+        };
+
+    public:
+        priority_queue():
+            m_head(nullptr),
+            m_registry(
+                [this] (uint64_t i) {
+                    m_hpm.thread_init(i);
+                    m_thread_data[i].random = (i + 1) * 0x9e3779b97f4a7c15;
+                },
+                [this] (uint64_t i) { m_hpm.thread_release(i); }
+            )
+        {
+            auto head = m_hpm.get_node(0);
+            head->height = MAX_LEVEL;
+            m_head = head;
+        }
+        // the nodes unlinked at level 0 may still be linked above it
+        ~priority_queue()
+        {
+            std::vector<node_type*> nodes;
+            for(uint64_t i = 0; i < MAX_LEVEL; ++i)
+            {
+                auto ptr = clear_mark(
+                    m_head->get_next(i).load(std::memory_order_relaxed)
+                );
+                for(; ptr; ptr = clear_mark(
+                    ptr->get_next(i).load(std::memory_order_relaxed)
+                )) nodes.push_back(ptr);
+            }
+            std::sort(nodes.begin(), nodes.end());
+            nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+            for(auto ptr : nodes) m_hpm.physically_remove_node(ptr);
+            m_hpm.physically_remove_node(m_head);
+        }
+
+        uint64_t get_thread_index()
+        {
+            return m_registry.get_thread_index();
+        }
+        // optional, the slot is taken at the first call anyway
+        void thread_init()
+        {
+            get_thread_index();
+        }
+        // optional
+        void init(
+            uint64_t init_nodes_number = 0,
+            uint64_t max_nodes_number = 0
+        ) {
+            m_hpm.init(
+                m_registry.get_threads_number(),
+                init_nodes_number,
+                max_nodes_number
+            );
+        }
+
+        // the equal priorities are ordered by the node addresses
+        bool push(const priority_type& priority, const value_type& value)
+        {
+            uint64_t thread_index = get_thread_index();
+            auto clear = make_scope_exit(
+                [this, thread_index] () {
+                    m_hpm.set_hp(thread_index, 0, nullptr);
+                    m_hpm.set_hp(thread_index, 1, nullptr);
+                }
+            );
+            auto new_node = m_hpm.get_node(thread_index);
+            new_node->priority = priority;
+            new_node->value = value;
+            new_node->height = get_random_height(thread_index);
+            auto id = get_id(new_node);
+            // level 0 and the hold of this push
+            new_node->links.store(2, std::memory_order_relaxed);
+
+            while(true)
+            {
+                auto res = find(thread_index, priority, id, 0);
+                new_node->next.store(res.succ, std::memory_order_relaxed);
+                if(res.pred->next.compare_exchange_strong(
+                    res.succ, new_node, std::memory_order_acq_rel
+                )) break;
+                m_backoff.wait();
+            }
+
+            for(uint64_t level = 1; level < new_node->height; ++level)
+            {
+                if(!link(thread_index, new_node, id, level)) break;
+            }
+            // popped meanwhile, the levels linked after the marks
+            // are unlinked here
+            if(is_marked(new_node->next.load(std::memory_order_acquire)))
+                find(thread_index, priority, id, 0);
+            release_link(thread_index, new_node);
+
+            return true;
+        }
+
+        // false if the queue is empty
+        bool pop_min(priority_type& priority, value_type& value)
+        {
+            uint64_t thread_index = get_thread_index();
+            auto clear = make_scope_exit(
+                [this, thread_index] () {
+                    m_hpm.set_hp(thread_index, 0, nullptr);
+                    m_hpm.set_hp(thread_index, 1, nullptr);
+                }
+            );
+            uint64_t skip =
+                SPREAD > 1 ? get_random(thread_index) % SPREAD : 0;
+            node_type* pred{}, *curr{}, *next{};
+
+            AGAIN:
+            uint64_t skipped = 0;
+            pred = m_head;
+            m_hpm.set_hp(thread_index, 0, pred);
+            curr = pred->next.load(std::memory_order_acquire);
+            m_hpm.set_hp(thread_index, 1, curr);
+            if(
+                hp_manager_type::NEED_HP_VALIDATION &&
+                curr != pred->next.load(std::memory_order_seq_cst)
+            ) goto AGAIN;
+            while(curr)
+            {
+                next = curr->next.load(std::memory_order_acquire);
+                if(is_marked(next))
+                {
+                    if(!unlink(thread_index, pred, curr, 0)) goto AGAIN;
+                    continue;
+                }
+                // the last node is taken even if less than skip are seen
+                if(skipped < skip && next)
+                {
+                    ++skipped;
+                    pred = curr;
+                    m_hpm.set_hp(thread_index, 0, pred);
+                    curr = next;
+                    m_hpm.set_hp(thread_index, 1, curr);
+                    if(
+                        hp_manager_type::NEED_HP_VALIDATION &&
+                        curr != pred->next.load(std::memory_order_seq_cst)
+                    ) goto AGAIN;
+                    continue;
+                }
+                if(mark(curr))
+                {
+                    priority = curr->priority;
+                    value = curr->value;
+                    find(thread_index, priority, get_id(curr), 0);
+                    return true;
+                }
+                m_backoff.wait();
+            }
+
+            return false;
+        }
+
+    private:
+        static bool is_marked(node_type* p)
+        {
+            return reinterpret_cast<uint64_t>(p) & REMOVED_MARK;
+        }
+        static node_type* clear_mark(node_type* p)
+        {
+            return reinterpret_cast<node_type*>(
+                reinterpret_cast<uint64_t>(p) & ~REMOVED_MARK
+            );
+        }
+        static node_type* add_mark(node_type* p)
+        {
+            return reinterpret_cast<node_type*>(
+                reinterpret_cast<uint64_t>(p) | REMOVED_MARK
+            );
+        }
+        static uint64_t get_id(node_type* p)
+        {
+            return reinterpret_cast<uint64_t>(p);
+        }
+        // (priority, id) of ptr is less than the given one
+        static bool less(
+            node_type* ptr,
+            const priority_type& priority,
+            uint64_t id
+        ) {
+            if(ptr->priority < priority) return true;
+            if(priority < ptr->priority) return false;
+            return get_id(ptr) < id;
+        }
+
+        uint64_t get_random(uint64_t thread_index)
+        {
+            auto& state = m_thread_data[thread_index].random;
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            return state;
+        }
+        // level i is reached with the probability 1 / 2^i
+        uint64_t get_random_height(uint64_t thread_index)
+        {
+            auto random = get_random(thread_index);
+            uint64_t height = 1;
+            while(height < MAX_LEVEL && (random & 1))
+            {
+                ++height;
+                random >>= 1;
+            }
+            return height;
+        }
+
+        // the levels from the top, the level 0 last; false if
+        // another thread has marked the level 0 first
+        bool mark(node_type* ptr)
+        {
+            for(uint64_t level = ptr->height - 1; level > 0; --level)
+            {
+                auto& next = ptr->get_next(level);
+                auto expected = next.load(std::memory_order_relaxed);
+                while(!is_marked(expected) && !next.compare_exchange_weak(
+                    expected, add_mark(expected), std::memory_order_acq_rel
+                ));
+            }
+            auto expected = ptr->next.load(std::memory_order_relaxed);
+            while(!is_marked(expected))
+            {
+                if(ptr->next.compare_exchange_weak(
+                    expected, add_mark(expected), std::memory_order_acq_rel
+                )) return true;
+            }
+            return false;
+        }
+        void release_link(uint64_t thread_index, node_type* ptr)
+        {
+            if(ptr->links.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                m_hpm.remove_node(thread_index, ptr);
+        }
+        // the marked curr is replaced by its next at level, curr becomes
+        // that next in the hp 1; false if pred has changed
+        bool unlink(
+            uint64_t thread_index,
+            node_type* pred,
+            node_type*& curr,
+            uint64_t level
+        ) {
+            // the next of a marked node can't be unlinked before it
+            auto next = clear_mark(
+                curr->get_next(level).load(std::memory_order_acquire)
+            );
+            auto expected = curr;
+            if(!pred->get_next(level).compare_exchange_strong(
+                expected, next, std::memory_order_acq_rel
+            )) {
+                m_backoff.wait();
+                return false;
+            }
+            release_link(thread_index, curr);
+            curr = next;
+            m_hpm.set_hp(thread_index, 1, curr);
+            return !hp_manager_type::NEED_HP_VALIDATION ||
+                curr == pred->get_next(level).load(std::memory_order_seq_cst);
+        }
+
+        // pred and succ at level with pred < (priority, id) <= succ,
+        // kept in the hps 0 and 1; the marked nodes on the way from the
+        // top are unlinked
+        find_result find(
+            uint64_t thread_index,
+            const priority_type& priority,
+            uint64_t id,
+            uint64_t level
+        ) {
+            node_type* pred{}, *curr{}, *next{};
+
+            // m_head lives as long as the queue, it is published in the
+            // position 0 anyway, clearing that ends the operation for the
+            // epoch and era managers
+            AGAIN:
+            pred = m_head;
+            m_hpm.set_hp(thread_index, 0, pred);
+            for(uint64_t i = MAX_LEVEL; i-- > level;)
+            {
+                curr = pred->get_next(i).load(std::memory_order_acquire);
+                // pred is deleted at this level
+                if(is_marked(curr)) goto AGAIN;
+                m_hpm.set_hp(thread_index, 1, curr);
+                if(
+                    hp_manager_type::NEED_HP_VALIDATION &&
+                    curr != pred->get_next(i).load(std::memory_order_seq_cst)
+                ) goto AGAIN;
+                while(curr)
+                {
+                    next = curr->get_next(i).load(std::memory_order_acquire);
+                    if(is_marked(next))
+                    {
+                        if(!unlink(thread_index, pred, curr, i)) goto AGAIN;
+                        continue;
+                    }
+                    if(!less(curr, priority, id)) break;
+
+                    pred = curr;
+                    m_hpm.set_hp(thread_index, 0, pred);
+                    curr = next;
+                    m_hpm.set_hp(thread_index, 1, curr);
+                    if(
+                        hp_manager_type::NEED_HP_VALIDATION &&
+                        curr != pred->get_next(i).load(std::memory_order_seq_cst)
+                    ) goto AGAIN;
+                }
+            }
+
+            return find_result{pred, curr};
+        }
+        // false if ptr is marked at level before it is linked there
+        bool link(
+            uint64_t thread_index,
+            node_type* ptr,
+            uint64_t id,
+            uint64_t level
+        ) {
+            ptr->links.fetch_add(1, std::memory_order_relaxed);
+            auto& next = ptr->get_next(level);
+            while(true)
+            {
+                auto res = find(thread_index, ptr->priority, id, level);
+                // only pop_min marks it besides, so a failure is a mark
+                auto expected = next.load(std::memory_order_acquire);
+                if(is_marked(expected) || !next.compare_exchange_strong(
+                    expected, res.succ, std::memory_order_acq_rel
+                )) break;
+                if(res.pred->get_next(level).compare_exchange_strong(
+                    res.succ, ptr, std::memory_order_acq_rel
+                )) return true;
+                m_backoff.wait();
+            }
+            ptr->links.fetch_sub(1, std::memory_order_relaxed);
+            return false;
+        }
+
+    private:
+        node_type* m_head;
+        char padding1[128 - sizeof m_head];
+        hp_manager_type m_hpm;
+        backoff_strategy_type m_backoff;
+        std::array<perthread_data_type, MAX_THREADS_NUMBER> m_thread_data;
+        thread_registry<MAX_THREADS_NUMBER> m_registry;
+    };
+    //
+}
+}
+
+#endif // __HAZARD_POINTERS_PRIORITY_QUEUE_HPP__
@@ -4,6 +4,7 @@
 #include <cstdint>
 
 #include <atomic>
+#include <chrono>
 #include <memory>
 #include <utility>
 
@@ -27,6 +28,7 @@ namespace hp
             std::allocator<T>,
             basic_backoff
         >,
+        typename Waiting = no_waiting, // or futex_waiting
         typename Tag = void // for creating different objects of the same T
     > class queue: boost::noncopyable
     {
@@ -39,35 +41,41 @@ namespace hp
         using allocator_type = typename hp_manager_type::allocator_type;
         using backoff_strategy_type =
             typename hp_manager_type::backoff_strategy_type;
+        using waiting_type = Waiting;
 
     public:
-        queue(): m_thread_index_calculator(0), m_head(nullptr), m_tail(nullptr) {}
+        queue():
+            m_head(nullptr),
+            m_tail(nullptr),
+            m_registry(
+                [this] (uint64_t i) { m_hpm.thread_init(i); },
+                [this] (uint64_t i) { m_hpm.thread_release(i); }
+            )
+        {
+            m_head.store(m_hpm.get_node(0), std::memory_order_relaxed);
+            m_tail.store(
+                m_head.load(std::memory_order_relaxed), std::memory_order_relaxed
+            );
+        }
         uint64_t get_thread_index()
         {
-            thread_local static uint64_t thread_index =
-                m_thread_index_calculator.fetch_add(1, std::memory_order_acquire);
-            return thread_index;
+            return m_registry.get_thread_index();
         }
+        // optional, the slot is taken at the first call anyway
         void thread_init()
         {
-            if(m_thread_index_calculator.load(std::memory_order_acquire) >=
-               MAX_THREADS_NUMBER
-            ) throw std::runtime_error("Too many threads");
-            m_hpm.thread_init( get_thread_index() );
+            get_thread_index();
         }
+        // optional
         void init(
             uint64_t init_nodes_number = 0,
             uint64_t max_nodes_number = 0
         ) {
             m_hpm.init(
-                m_thread_index_calculator.load(std::memory_order_relaxed),
+                m_registry.get_threads_number(),
                 init_nodes_number,
                 max_nodes_number
             );
-            m_head.store(m_hpm.get_node(0), std::memory_order_relaxed);
-            m_tail.store(
-                m_head.load(std::memory_order_relaxed), std::memory_order_relaxed
-            );
         }
 
         bool push(const value_type& val)
@@ -102,6 +110,7 @@ namespace hp
                 }
                 m_backoff.wait();
             }
+            m_not_empty.notify();
 
             return true;
         }
@@ -119,7 +128,8 @@ namespace hp
                 auto tail = m_tail.load(std::memory_order_consume);
                 auto hnext = head->next.load(std::memory_order_consume);
                 m_hpm.set_hp(thread_index, 1, hnext);
-                //if(head != m_head.load(std::memory_order_seq_cst)) continue;
+                // hnext may be already dequeued and reused otherwise
+                if(head != m_head.load(std::memory_order_seq_cst)) continue;
 
                 if(!hnext)
                 {
@@ -146,15 +156,146 @@ namespace hp
 
             return true;
         }
+        // blocks until a value is popped, false if the timeout expired
+        bool pop_wait(
+            value_type& val,
+            std::chrono::nanoseconds timeout = std::chrono::nanoseconds::max()
+        ) {
+            static_assert(
+                waiting_type::ENABLED,
+                "pop_wait needs a waiting policy, e.g. futex_waiting"
+            );
+            return m_not_empty.wait_for(timeout, [&] { return pop(val); });
+        }
+
+        // the chain is linked privately and published with one CAS on
+        // tail->next; returns the number pushed
+        template <typename InputIterator>
+        uint64_t push_bulk(InputIterator first, InputIterator last)
+        {
+            if(first == last) return 0;
+            uint64_t thread_index = get_thread_index();
+            node_type* chain_head = nullptr;
+            node_type* chain_tail = nullptr;
+            uint64_t number = 0;
+            for(; first != last; ++first, ++number)
+            {
+                auto new_node = m_hpm.get_node(thread_index, *first);
+                if(!chain_head) chain_head = new_node;
+                else chain_tail->next.store(new_node, std::memory_order_relaxed);
+                chain_tail = new_node;
+            }
+
+            while(true)
+            {
+                auto tail = m_tail.load(std::memory_order_consume);
+                m_hpm.set_hp(thread_index, 0, tail);
+                if(tail != m_tail.load(std::memory_order_acquire)) continue;
+
+                auto tnext = tail->next.load(std::memory_order_consume);
+                if(tnext != nullptr)
+                {
+                    if(!m_tail.compare_exchange_strong(
+                        tail, tnext, std::memory_order_release
+                    )) m_backoff.wait();
+                    continue;
+                }
+
+                if(tail->next.compare_exchange_strong(
+                    tnext, chain_head, std::memory_order_release
+                )) {
+                    m_tail.compare_exchange_strong(
+                        tail, chain_tail, std::memory_order_acq_rel
+                    );
+                    break;
+                }
+                m_backoff.wait();
+            }
+            m_hpm.set_hp(thread_index, 0, nullptr);
+            m_not_empty.notify(number);
+
+            return number;
+        }
+        // m_head is moved over up to number nodes with one CAS, but never
+        // past m_tail; returns the number of values written to out
+        uint64_t pop_bulk(value_type* out, uint64_t number)
+        {
+            if(!number) return 0;
+            node_type* head = nullptr;
+            node_type* new_head = nullptr;
+            uint64_t popped = 0;
+            auto thread_index = get_thread_index();
+
+            while(true)
+            {
+                head = m_head.load(std::memory_order_consume);
+                m_hpm.set_hp(thread_index, 0, head);
+                if(head != m_head.load(std::memory_order_acquire)) continue;
+                auto tail = m_tail.load(std::memory_order_consume);
+                auto hnext = head->next.load(std::memory_order_consume);
+                m_hpm.set_hp(thread_index, 1, hnext);
+                if(head != m_head.load(std::memory_order_seq_cst)) continue;
+
+                if(!hnext)
+                {
+                    m_hpm.set_hp(thread_index, 1, nullptr);
+                    m_hpm.set_hp(thread_index, 0, nullptr);
+                    return 0;
+                }
+                if(head == tail)
+                {
+                    if(!m_tail.compare_exchange_strong(
+                        tail, hnext, std::memory_order_release
+                    )) m_backoff.wait();
+                    continue;
+                }
+
+                // hand over hand on hps 1 and 2, the nodes between head
+                // and tail aren't retired while m_head is unchanged
+                popped = 0;
+                new_head = hnext;
+                out[popped++] = hnext->value;
+                bool valid = true;
+                while(popped < number && new_head != tail)
+                {
+                    auto next = new_head->next.load(std::memory_order_consume);
+                    if(!next) break;
+                    m_hpm.set_hp(thread_index, 1 + popped % 2, next);
+                    if(head != m_head.load(std::memory_order_seq_cst))
+                    {
+                        valid = false;
+                        break;
+                    }
+                    out[popped++] = next->value;
+                    new_head = next;
+                }
+                if(valid && m_head.compare_exchange_strong(
+                    head, new_head, std::memory_order_acq_rel
+                )) break;
+                m_backoff.wait();
+            }
+            m_hpm.set_hp(thread_index, 2, nullptr);
+            m_hpm.set_hp(thread_index, 1, nullptr);
+            m_hpm.set_hp(thread_index, 0, nullptr);
+            while(head != new_head)
+            {
+                auto next = head->next.load(std::memory_order_relaxed);
+                m_hpm.remove_node(thread_index, head);
+                head = next;
+            }
+
+            return popped;
+        }
 
     private:
-        std::atomic<uint64_t> m_thread_index_calculator;
         std::atomic<node_type*> m_head;
         char padding[128 - sizeof m_head];
         std::atomic<node_type*> m_tail;
         char padding1[128 - sizeof m_tail];
         hp_manager_type m_hpm;
         backoff_strategy_type m_backoff;
+        waiting_type m_not_empty;
+        thread_registry<MAX_THREADS_NUMBER> m_registry;
     };
     //
 }
@@ -0,0 +1,259 @@
+#ifndef __HAZARD_POINTERS_SEGMENT_QUEUE_HPP__
+#define __HAZARD_POINTERS_SEGMENT_QUEUE_HPP__
+
+#include <cstdint>
+
+#include <atomic>
+#include <array>
+#include <memory>
+#include <utility>
+#include <type_traits>
+
+#include <boost/noncopyable.hpp>
+
+#include "../technical.hpp"
+
+
+
+namespace lock_free
+{
+namespace hp
+{
+    // the ring segment is the hp_manager node, slots are never reused
+    // while the segment is in the queue
+    template <typename T, uint64_t SegmentSize = 1024>
+    struct segment_node
+    {
+        static constexpr uint64_t SEGMENT_SIZE = SegmentSize;
+        static constexpr uint64_t EMPTY = 0;
+        static constexpr uint64_t FULL = 1;
+        static constexpr uint64_t TAKEN = 2;
+
+        using value_type = T;
+
+        struct slot_type
+        {
+            std::atomic<uint64_t> state;
+            value_type value;
+        };
+
+        segment_node(): next(nullptr), enq_index(0), deq_index(0)
+        {
+            for(auto& slot : slots)
+                slot.state.store(EMPTY, std::memory_order_relaxed);
+        }
+
+        std::atomic<segment_node*> next;
+        char padding[128 - sizeof next];
+        std::atomic<uint64_t> enq_index;
+        char padding1[128 - sizeof enq_index];
+        std::atomic<uint64_t> deq_index;
+        char padding2[128 - sizeof deq_index];
+        std::array<slot_type, SEGMENT_SIZE> slots;
+        uint64_t birth_era = 0; // for ibr_manager
+        uint64_t retire_era = 0;
+    };
+
+    // unbounded queue of linked ring segments, the slots are claimed
+    // by fetch_add on the segment indices instead of CAS on head/tail
+    template<
+        uint64_t MaxThreadsNumber,
+        typename T,
+        typename HpManager = hp_manager<
+            MaxThreadsNumber,
+            segment_node<T>,
+            std::allocator<T>,
+            basic_backoff
+        >,
+        typename Tag = void // for creating different objects of the same T
+    > class segment_queue: boost::noncopyable
+    {
+    public:
+        static_assert(
+            std::is_trivially_copyable<T>::value,
+            "T must be trivially copyable"
+        );
+
+        static constexpr uint64_t MAX_THREADS_NUMBER = MaxThreadsNumber;
+
+        using value_type = T;
+        using hp_manager_type = HpManager;
+        using node_type = typename hp_manager_type::node_type;
+        using allocator_type = typename hp_manager_type::allocator_type;
+        using backoff_strategy_type =
+            typename hp_manager_type::backoff_strategy_type;
+
+        static constexpr uint64_t SEGMENT_SIZE = node_type::SEGMENT_SIZE;
+
+    public:
+        segment_queue():
+            m_head(nullptr),
+            m_tail(nullptr),
+            m_registry(
+                [this] (uint64_t i) { m_hpm.thread_init(i); },
+                [this] (uint64_t i) { m_hpm.thread_release(i); }
+            )
+        {
+            m_head.store(m_hpm.get_node(0), std::memory_order_relaxed);
+            m_tail.store(
+                m_head.load(std::memory_order_relaxed), std::memory_order_relaxed
+            );
+        }
+        // the segments are too large to leak them, hp_manager frees them
+        ~segment_queue()
+        {
+            auto ptr = m_head.load(std::memory_order_relaxed);
+            while(ptr)
+            {
+                auto next = ptr->next.load(std::memory_order_relaxed);
+                m_hpm.physically_remove_node(ptr);
+                ptr = next;
+            }
+        }
+        uint64_t get_thread_index()
+        {
+            return m_registry.get_thread_index();
+        }
+        // optional, the slot is taken at the first call anyway
+        void thread_init()
+        {
+            get_thread_index();
+        }
+        // optional
+        void init(
+            uint64_t init_nodes_number = 0,
+            uint64_t max_nodes_number = 0
+        ) {
+            m_hpm.init(
+                m_registry.get_threads_number(),
+                init_nodes_number,
+                max_nodes_number
+            );
+        }
+
+        bool push(const value_type& val)
+        {
+            uint64_t thread_index = get_thread_index();
+
+            while(true)
+            {
+                auto tail = m_tail.load(std::memory_order_acquire);
+                m_hpm.set_hp(thread_index, 0, tail);
+                if(tail != m_tail.load(std::memory_order_acquire)) continue;
+
+                auto index = tail->enq_index.fetch_add(
+                    1, std::memory_order_acq_rel
+                );
+                if(index < SEGMENT_SIZE)
+                {
+                    auto& slot = tail->slots[index];
+                    slot.value = val;
+                    uint64_t expected = node_type::EMPTY;
+                    // fails if a consumer has overtaken the slot
+                    if(slot.state.compare_exchange_strong(
+                        expected, node_type::FULL, std::memory_order_acq_rel
+                    )) break;
+                    continue;
+                }
+
+                // the segment is exhausted, link the next one
+                auto tnext = tail->next.load(std::memory_order_acquire);
+                if(tnext != nullptr)
+                {
+                    if(!m_tail.compare_exchange_strong(
+                        tail, tnext, std::memory_order_acq_rel
+                    )) m_backoff.wait();
+                    continue;
+                }
+
+                auto new_node = m_hpm.get_node(thread_index);
+                new_node->slots[0].value = val;
+                new_node->slots[0].state.store(
+                    node_type::FULL, std::memory_order_relaxed
+                );
+                new_node->enq_index.store(1, std::memory_order_relaxed);
+                if(tail->next.compare_exchange_strong(
+                    tnext, new_node, std::memory_order_acq_rel
+                )) {
+                    m_tail.compare_exchange_strong(
+                        tail, new_node, std::memory_order_acq_rel
+                    );
+                    break;
+                }
+                m_hpm.physically_remove_node(new_node);
+                m_backoff.wait();
+            }
+            m_hpm.set_hp(thread_index, 0, nullptr);
+
+            return true;
+        }
+
+        bool pop(value_type& val)
+        {
+            auto thread_index = get_thread_index();
+
+            while(true)
+            {
+                auto head = m_head.load(std::memory_order_acquire);
+                m_hpm.set_hp(thread_index, 0, head);
+                if(head != m_head.load(std::memory_order_acquire)) continue;
+
+                if(head->deq_index.load(std::memory_order_acquire) >=
+                   head->enq_index.load(std::memory_order_acquire) &&
+                   head->next.load(std::memory_order_acquire) == nullptr
+                ) break;
+
+                auto index = head->deq_index.fetch_add(
+                    1, std::memory_order_acq_rel
+                );
+                if(index < SEGMENT_SIZE)
+                {
+                    auto& slot = head->slots[index];
+                    // a slow producer will retry in another slot
+                    if(slot.state.exchange(
+                        node_type::TAKEN, std::memory_order_acq_rel
+                    ) != node_type::FULL) continue;
+                    val = slot.value;
+                    m_hpm.set_hp(thread_index, 0, nullptr);
+                    return true;
+                }
+
+                // the segment is drained, move to the next one
+                auto hnext = head->next.load(std::memory_order_acquire);
+                if(hnext == nullptr) break;
+                // head mustn't pass tail, m_tail may still refer to it
+                auto tail = m_tail.load(std::memory_order_acquire);
+                if(head == tail)
+                {
+                    m_tail.compare_exchange_strong(
+                        tail, hnext, std::memory_order_acq_rel
+                    );
+                }
+                if(m_head.compare_exchange_strong(
+                    head, hnext, std::memory_order_acq_rel
+                )) {
+                    m_hpm.set_hp(thread_index, 0, nullptr);
+                    m_hpm.remove_node(thread_index, head);
+                    continue;
+                }
+                m_backoff.wait();
+            }
+            m_hpm.set_hp(thread_index, 0, nullptr);
+
+            return false;
+        }
+
+    private:
+        std::atomic<node_type*> m_head;
+        char padding[128 - sizeof m_head];
+        std::atomic<node_type*> m_tail;
+        char padding1[128 - sizeof m_tail];
+        hp_manager_type m_hpm;
+        backoff_strategy_type m_backoff;
+        thread_registry<MAX_THREADS_NUMBER> m_registry;
+    };
+    //
+}
+}
+
+#endif // __HAZARD_POINTERS_SEGMENT_QUEUE_HPP__
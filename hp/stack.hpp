@@ -29,6 +29,7 @@ namespace hp
             std::allocator<T>,
             basic_backoff
         >,
+        typename Elimination = no_elimination, // or elimination_array<T>
         typename Tag = void // for creating different objects of the same T
     > class stack: boost::noncopyable
     {
@@ -46,32 +47,37 @@ namespace hp
         using allocator_type = typename hp_manager_type::allocator_type;
         using backoff_strategy_type =
             typename hp_manager_type::backoff_strategy_type;
+        using elimination_type = Elimination;
 
     public:
-        stack(): m_thread_index_calculator(0), m_head(nullptr) {}
+        stack():
+            m_head(nullptr),
+            m_registry(
+                [this] (uint64_t i) { m_hpm.thread_init(i); },
+                [this] (uint64_t i) { m_hpm.thread_release(i); }
+            )
+        {
+            m_head.store(m_hpm.get_node(0), std::memory_order_relaxed);
+        }
         uint64_t get_thread_index()
         {
-            thread_local static uint64_t thread_index =
-                m_thread_index_calculator.fetch_add(1, std::memory_order_acquire);
-            return thread_index;
+            return m_registry.get_thread_index();
         }
+        // optional, the slot is taken at the first call anyway
         void thread_init()
         {
-            if(m_thread_index_calculator.load(std::memory_order_acquire) >=
-               MAX_THREADS_NUMBER
-            ) throw std::runtime_error("Too many threads");
-            m_hpm.thread_init( get_thread_index() );
+            get_thread_index();
         }
+        // optional
         void init(
             uint64_t init_nodes_number = 0,
             uint64_t max_nodes_number = 0
         ) {
             m_hpm.init(
-                m_thread_index_calculator.load(std::memory_order_relaxed),
+                m_registry.get_threads_number(),
                 init_nodes_number,
                 max_nodes_number
             );
-            m_head.store(m_hpm.get_node(0), std::memory_order_relaxed);
         }
 
         bool push(const value_type& val)
@@ -94,6 +100,11 @@ namespace hp
                     std::memory_order_acq_rel
                 )) break;
 
+                if(m_elimination.try_push(val))
+                {
+                    m_hpm.physically_remove_node(new_node);
+                    break;
+                }
                 m_backoff.wait();
             }
             m_hpm.set_hp(thread_index, 0, nullptr);
@@ -127,6 +138,11 @@ namespace hp
                     std::memory_order_acq_rel
                 )) break;
 
+                if(m_elimination.try_pop(val))
+                {
+                    m_hpm.set_hp(thread_index, 0, nullptr);
+                    return true;
+                }
                 m_backoff.wait();
             }
             m_hpm.set_hp(thread_index, 0, nullptr);
@@ -135,11 +151,74 @@ namespace hp
             return true;
         }
 
+        // the chain is linked privately and published with one CAS,
+        // the last value ends up on the top; returns the number pushed
+        template <typename InputIterator>
+        uint64_t push_range(InputIterator first, InputIterator last)
+        {
+            if(first == last) return 0;
+            uint64_t thread_index = get_thread_index();
+            node_type* top = nullptr;
+            node_type* bottom = nullptr;
+            uint64_t number = 0;
+            for(; first != last; ++first, ++number)
+            {
+                auto new_node = m_hpm.get_node(thread_index, *first);
+                new_node->next.store(top, std::memory_order_relaxed);
+                if(!top) bottom = new_node;
+                top = new_node;
+            }
+
+            while(true)
+            {
+                auto head = m_head.load(std::memory_order_consume);
+                m_hpm.set_hp(thread_index, 0, head);
+                if(head != m_head.load(std::memory_order_acquire))
+                {
+                    continue;
+                }
+                bottom->next.store(head, std::memory_order_relaxed);
+                if(m_head.compare_exchange_weak(
+                    head,
+                    top,
+                    std::memory_order_acq_rel
+                )) break;
+                m_backoff.wait();
+            }
+            m_hpm.set_hp(thread_index, 0, nullptr);
+
+            return number;
+        }
+        // the whole chain is detached by swapping in a new bottom node,
+        // the values go out from the top; returns the number popped
+        template <typename OutputIterator>
+        uint64_t pop_all(OutputIterator out)
+        {
+            auto thread_index = get_thread_index();
+            auto head = m_head.exchange(
+                m_hpm.get_node(thread_index), std::memory_order_acq_rel
+            );
+
+            uint64_t number = 0;
+            // the chain is private now, only readers may still hold it
+            while(auto next = head->next.load(std::memory_order_acquire))
+            {
+                *out++ = head->value;
+                ++number;
+                m_hpm.remove_node(thread_index, head);
+                head = next;
+            }
+            m_hpm.remove_node(thread_index, head);
+
+            return number;
+        }
+
     private:
-        std::atomic<uint64_t> m_thread_index_calculator;
         std::atomic<node_type*> m_head;
         hp_manager_type m_hpm;
         backoff_strategy_type m_backoff;
+        elimination_type m_elimination;
+        thread_registry<MAX_THREADS_NUMBER> m_registry;
     };
     //
 }
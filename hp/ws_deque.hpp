@@ -0,0 +1,235 @@
+#ifndef __HAZARD_POINTERS_WS_DEQUE_HPP__
+#define __HAZARD_POINTERS_WS_DEQUE_HPP__
+
+#include <cstdint>
+
+#include <atomic>
+#include <memory>
+#include <type_traits>
+
+#include <boost/noncopyable.hpp>
+
+#include "../technical.hpp"
+
+
+
+namespace lock_free
+{
+namespace hp
+{
+    // the circular array of ws_deque, hp_manager recycles it as a node
+    template <typename T>
+    struct ws_buffer
+    {
+        using value_type = T;
+
+        ws_buffer(): next(nullptr) {}
+
+        void init(uint64_t capacity)
+        {
+            data.reset(new value_type[capacity]);
+            mask = capacity - 1;
+        }
+        uint64_t get_capacity() const
+        {
+            return mask + 1;
+        }
+        value_type& get(int64_t index)
+        {
+            return data[static_cast<uint64_t>(index) & mask];
+        }
+
+        // for the free nodes of hp_manager
+        std::atomic<ws_buffer*> next;
+        uint64_t mask = 0;
+        std::unique_ptr<value_type[]> data;
+        uint64_t birth_era = 0; // for ibr_manager
+        uint64_t retire_era = 0;
+    };
+
+    // Chase-Lev work-stealing deque: the owner pushes and pops at the
+    // bottom, the other threads steal at the top; the array grows by
+    // doubling, the thieves may still read the old one, so it is retired
+    // through the hp manager
+    template<
+        uint64_t MaxThreadsNumber,
+        typename T,
+        typename HpManager = hp_manager<
+            MaxThreadsNumber,
+            ws_buffer<T>,
+            std::allocator<T>,
+            basic_backoff
+        >,
+        typename Tag = void // for creating different objects of the same T
+    > class ws_deque: boost::noncopyable
+    {
+    public:
+        static_assert(
+            std::is_trivially_copyable<T>::value,
+            "T must be trivially copyable"
+        );
+
+        static constexpr uint64_t MAX_THREADS_NUMBER = MaxThreadsNumber;
+
+        using value_type = T;
+        using hp_manager_type = HpManager;
+        using buffer_type = typename hp_manager_type::node_type;
+        using allocator_type = typename hp_manager_type::allocator_type;
+        using backoff_strategy_type =
+            typename hp_manager_type::backoff_strategy_type;
+
+    public:
+        // the capacity is rounded up to a power of two
+        ws_deque(uint64_t capacity = 1024):
+            m_top(0),
+            m_bottom(0),
+            m_buffer(nullptr),
+            m_registry(
+                [this] (uint64_t i) { m_hpm.thread_init(i); },
+                [this] (uint64_t i) { m_hpm.thread_release(i); }
+            )
+        {
+            auto buffer = m_hpm.get_node(0);
+            buffer->init(round_up_pow2(capacity < 2 ? 2 : capacity));
+            m_buffer.store(buffer, std::memory_order_relaxed);
+        }
+        ~ws_deque()
+        {
+            m_hpm.physically_remove_node(
+                m_buffer.load(std::memory_order_relaxed)
+            );
+        }
+
+        uint64_t get_thread_index()
+        {
+            return m_registry.get_thread_index();
+        }
+        // optional, the slot is taken at the first call anyway
+        void thread_init()
+        {
+            get_thread_index();
+        }
+        // optional
+        void init(
+            uint64_t init_nodes_number = 0,
+            uint64_t max_nodes_number = 0
+        ) {
+            m_hpm.init(
+                m_registry.get_threads_number(),
+                init_nodes_number,
+                max_nodes_number
+            );
+        }
+
+        // the owner only, never fails, the array grows when full
+        bool push(const value_type& val)
+        {
+            auto bottom = m_bottom.load(std::memory_order_relaxed);
+            auto top = m_top.load(std::memory_order_acquire);
+            auto buffer = m_buffer.load(std::memory_order_relaxed);
+            if(bottom - top >= static_cast<int64_t>(buffer->get_capacity()))
+                buffer = grow(buffer, top, bottom);
+            buffer->get(bottom) = val;
+            std::atomic_thread_fence(std::memory_order_release);
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+
+            return true;
+        }
+        // the owner only, the last pushed value; false if empty
+        bool pop(value_type& val)
+        {
+            auto bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+            auto buffer = m_buffer.load(std::memory_order_relaxed);
+            m_bottom.store(bottom, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            auto top = m_top.load(std::memory_order_relaxed);
+
+            if(top > bottom)
+            {
+                m_bottom.store(bottom + 1, std::memory_order_relaxed);
+                return false;
+            }
+            val = buffer->get(bottom);
+            if(top < bottom) return true;
+            // the last value, the thieves are raced by the CAS on top
+            bool ret = m_top.compare_exchange_strong(
+                top, top + 1,
+                std::memory_order_seq_cst, std::memory_order_relaxed
+            );
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+
+            return ret;
+        }
+        // any thread, the oldest value; false if empty, a lost race
+        // with another thief or the owner is retried
+        bool steal(value_type& val)
+        {
+            auto thread_index = get_thread_index();
+            auto clear = make_scope_exit(
+                [this, thread_index] () {
+                    m_hpm.set_hp(thread_index, 0, nullptr);
+                }
+            );
+
+            while(true)
+            {
+                auto top = m_top.load(std::memory_order_acquire);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                auto bottom = m_bottom.load(std::memory_order_acquire);
+                if(top >= bottom) return false;
+
+                auto buffer = m_buffer.load(std::memory_order_consume);
+                m_hpm.set_hp(thread_index, 0, buffer);
+                if(
+                    hp_manager_type::NEED_HP_VALIDATION &&
+                    buffer != m_buffer.load(std::memory_order_seq_cst)
+                ) continue;
+                val = buffer->get(top);
+                if(m_top.compare_exchange_strong(
+                    top, top + 1,
+                    std::memory_order_seq_cst, std::memory_order_relaxed
+                )) return true;
+                m_backoff.wait();
+            }
+        }
+
+        // approximate if called not by the owner
+        uint64_t size() const
+        {
+            auto bottom = m_bottom.load(std::memory_order_relaxed);
+            auto top = m_top.load(std::memory_order_relaxed);
+            return bottom > top ? bottom - top : 0;
+        }
+
+    private:
+        // the values in [top, bottom) are copied, the old array is left
+        // to the thieves that may read it
+        buffer_type* grow(buffer_type* buffer, int64_t top, int64_t bottom)
+        {
+            auto thread_index = get_thread_index();
+            auto new_buffer = m_hpm.get_node(thread_index);
+            new_buffer->init(2 * buffer->get_capacity());
+            for(auto i = top; i < bottom; ++i)
+                new_buffer->get(i) = buffer->get(i);
+            m_buffer.store(new_buffer, std::memory_order_release);
+            m_hpm.remove_node(thread_index, buffer);
+
+            return new_buffer;
+        }
+
+    private:
+        std::atomic<int64_t> m_top;
+        char padding1[128 - sizeof m_top];
+        std::atomic<int64_t> m_bottom;
+        char padding2[128 - sizeof m_bottom];
+        std::atomic<buffer_type*> m_buffer;
+        char padding3[128 - sizeof m_buffer];
+        hp_manager_type m_hpm;
+        backoff_strategy_type m_backoff;
+        thread_registry<MAX_THREADS_NUMBER> m_registry;
+    };
+    //
+}
+}
+
+#endif // __HAZARD_POINTERS_WS_DEQUE_HPP__
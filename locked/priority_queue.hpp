@@ -0,0 +1,67 @@
+#ifndef __LOCKED_PRIORITY_QUEUE_HPP__
+#define __LOCKED_PRIORITY_QUEUE_HPP__
+
+#include <mutex>
+#include <queue>
+#include <vector>
+#include <utility>
+
+#include <boost/noncopyable.hpp>
+
+#include "../technical.hpp"
+
+
+
+namespace locked
+{
+    //
+    template <
+        typename Priority,
+        typename T,
+        typename Lock
+    > class priority_queue: boost::noncopyable
+    {
+    private:
+        using priority_type = Priority;
+        using value_type = T;
+        using lock_type = Lock;
+        using entry_type = std::pair<priority_type, value_type>;
+        // the smallest priority on the top
+        struct greater
+        {
+            bool operator()(const entry_type& a, const entry_type& b) const
+            {
+                return b.first < a.first;
+            }
+        };
+
+    public:
+        priority_queue() = default;
+
+        bool push(const priority_type& priority, const value_type& value)
+        {
+            std::lock_guard<lock_type> lck(m_synch);
+            m_data.emplace(priority, value);
+            return true;
+        }
+
+        bool pop_min(priority_type& priority, value_type& value)
+        {
+            std::lock_guard<lock_type> lck(m_synch);
+            if (m_data.empty()) return false;
+            priority = m_data.top().first;
+            value = m_data.top().second;
+            m_data.pop();
+            return true;
+        }
+
+    private:
+        std::priority_queue<
+            entry_type, std::vector<entry_type>, greater
+        > m_data;
+        lock_type m_synch;
+    };
+    //
+}
+
+#endif // __LOCKED_PRIORITY_QUEUE_HPP__
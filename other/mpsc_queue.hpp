@@ -0,0 +1,102 @@
+#ifndef __OTHER_MPSC_QUEUE_HPP__
+#define __OTHER_MPSC_QUEUE_HPP__
+
+#include <cstdint>
+
+#include <atomic>
+#include <type_traits>
+
+#include <boost/noncopyable.hpp>
+
+#include "../technical.hpp"
+
+
+
+namespace lock_free
+{
+    // the link field, the objects of an intrusive queue derive from it
+    struct mpsc_hook
+    {
+        std::atomic<mpsc_hook*> next{nullptr};
+    };
+
+    // intrusive Vyukov queue, any number of producers, one consumer:
+    // push is one exchange on the tail, pop has no atomic RMW except
+    // when it takes the last object, then it pushes the stub behind it
+    // with the same exchange; nothing is allocated, the object belongs
+    // to the queue until it is popped
+    template <typename T>
+    class mpsc_queue: boost::noncopyable
+    {
+    public:
+        static_assert(
+            std::is_base_of<mpsc_hook, T>::value,
+            "T must derive from mpsc_hook"
+        );
+
+        using value_type = T;
+
+    public:
+        mpsc_queue(): m_tail(&m_stub), m_head(&m_stub) {}
+
+        // any thread, ptr must not be in a queue
+        bool push(value_type* ptr)
+        {
+            push_hook(static_cast<mpsc_hook*>(ptr));
+            return true;
+        }
+        // the consumer only; nullptr if empty, or if the next producer
+        // has swapped the tail but not linked its object yet
+        value_type* pop()
+        {
+            auto head = m_head;
+            auto next = head->next.load(std::memory_order_acquire);
+            if(head == &m_stub)
+            {
+                if(!next) return nullptr;
+                m_head = next;
+                head = next;
+                next = next->next.load(std::memory_order_acquire);
+            }
+            if(next)
+            {
+                m_head = next;
+                return static_cast<value_type*>(head);
+            }
+            // head is the last one, the stub goes behind it to detach it
+            if(head != m_tail.load(std::memory_order_acquire)) return nullptr;
+            push_hook(&m_stub);
+            next = head->next.load(std::memory_order_acquire);
+            if(next)
+            {
+                m_head = next;
+                return static_cast<value_type*>(head);
+            }
+            return nullptr;
+        }
+        // the consumer only
+        bool empty() const
+        {
+            return m_head == &m_stub &&
+                !m_stub.next.load(std::memory_order_acquire);
+        }
+
+    private:
+        void push_hook(mpsc_hook* ptr)
+        {
+            ptr->next.store(nullptr, std::memory_order_relaxed);
+            auto prev = m_tail.exchange(ptr, std::memory_order_acq_rel);
+            prev->next.store(ptr, std::memory_order_release);
+        }
+
+    private:
+        std::atomic<mpsc_hook*> m_tail;
+        char padding1[128 - sizeof m_tail];
+        mpsc_hook* m_head;
+        char padding2[128 - sizeof m_head];
+        mpsc_hook m_stub;
+    };
+    //
+}
+
+#endif // __OTHER_MPSC_QUEUE_HPP__
@@ -6,6 +6,9 @@
 #include <mutex>
 #include <queue>
 #include <array>
+#include <atomic>
+#include <algorithm>
+#include <type_traits>
 
 #include <boost/noncopyable.hpp>
 
@@ -16,54 +19,205 @@
 namespace other
 {
 	//
-    template <uint64_t Number, typename T>
+    // single producer single consumer ring; each side caches the index
+    // of the other and reloads it only when the ring looks full/empty,
+    // each side publishes its own index every BatchSize operations and
+    // whenever it finds the ring full/empty, so the producer never waits
+    // for an unfinished batch of pops; the consumer can't make the
+    // producer publish, so with BatchSize > 1 the producer must call
+    // flush when it goes idle, or up to BatchSize - 1 values stay unseen
+    template <uint64_t Number, typename T, uint64_t BatchSize = 1>
     class two_threads_queue: boost::noncopyable
     {
     public:
+        static_assert(
+            std::is_trivially_copyable<T>::value,
+            "T must be trivially copyable"
+        );
+        static_assert(
+            Number >= 2 && !(Number & (Number - 1)),
+            "Number must be a power of two"
+        );
+        static_assert(
+            BatchSize && BatchSize <= Number,
+            "BatchSize must be within 1..Number"
+        );
+
         static constexpr uint64_t DATA_NUMBER = Number;
+        static constexpr uint64_t MASK = Number - 1;
+        static constexpr uint64_t BATCH_SIZE = BatchSize;
 
         using value_type = T;
 
+        // contiguous slots in the ring memory
+        struct span_type
+        {
+            value_type* data = nullptr;
+            uint64_t size = 0;
+
+            value_type* begin() const { return data; }
+            value_type* end() const { return data + size; }
+        };
+
     public:
         two_threads_queue() = default;
 
+        // producer only; with BatchSize > 1 the value is seen by the
+        // consumer when the batch is full, the ring is full or on flush
         bool push(value_type const& val)
         {
-            if(m_data[i_push % DATA_NUMBER].load(std::memory_order_acquire) !=
-               value_type()
-            ) {
-                return false;
+            auto write = m_write_local;
+            if(write - m_cached_read == DATA_NUMBER)
+            {
+                m_cached_read = m_read.load(std::memory_order_acquire);
+                if(write - m_cached_read == DATA_NUMBER)
+                {
+                    // the consumer must see everything to make room
+                    flush();
+                    return false;
+                }
+            }
+            m_data[write & MASK] = val;
+            m_write_local = ++write;
+            m_reserved_number = 0;
+            if(BATCH_SIZE == 1) m_write.store(write, std::memory_order_release);
+            else if(write - m_write_published >= BATCH_SIZE)
+            {
+                m_write_published = write;
+                m_write.store(write, std::memory_order_release);
             }
-            auto previous_value = m_data[i_push % DATA_NUMBER].exchange(
-                val, std::memory_order_release
-            );
-            ++i_push;
 
             return true;
         }
+        // producer only, publishes the pushes of an unfinished batch
+        void flush()
+        {
+            if(BATCH_SIZE == 1 || m_write_published == m_write_local) return;
+            m_write_published = m_write_local;
+            m_write.store(m_write_local, std::memory_order_release);
+        }
 
-        bool pop(value_type& val)
+        // producer only, up to number free slots to be written in place;
+        // the span stops at the end of the ring, so it may be shorter
+        // and is empty if the ring is full
+        span_type reserve(uint64_t number)
         {
-            auto previous_value = m_data[i_pop % DATA_NUMBER].exchange(
-                value_type(), std::memory_order_release
+            auto write = m_write_local;
+            auto free_number = DATA_NUMBER - (write - m_cached_read);
+            if(free_number < number)
+            {
+                m_cached_read = m_read.load(std::memory_order_acquire);
+                free_number = DATA_NUMBER - (write - m_cached_read);
+            }
+            span_type span;
+            span.data = &m_data[write & MASK];
+            span.size = std::min(
+                std::min(number, free_number),
+                DATA_NUMBER - (write & MASK)
             );
-            if(previous_value == value_type())
+            m_reserved_number = span.size;
+            return span;
+        }
+        // producer only, publishes the first number slots of the last
+        // reserved span along with the pushes of an unfinished batch;
+        // a push in between drops the span
+        void commit(uint64_t number)
+        {
+            assert(number <= m_reserved_number);
+            m_reserved_number = 0;
+            m_write_local += number;
+            m_write_published = m_write_local;
+            m_write.store(m_write_local, std::memory_order_release);
+        }
+
+        // consumer only, up to number filled slots to be read in place;
+        // they stay valid until release
+        span_type peek(uint64_t number)
+        {
+            auto read = m_read_local;
+            auto filled_number = m_cached_write - read;
+            if(filled_number < number)
             {
-                return false;
+                m_cached_write = m_write.load(std::memory_order_acquire);
+                filled_number = m_cached_write - read;
+            }
+            span_type span;
+            span.data = &m_data[read & MASK];
+            span.size = std::min(
+                std::min(number, filled_number),
+                DATA_NUMBER - (read & MASK)
+            );
+            m_peeked_number = span.size;
+            return span;
+        }
+        // consumer only, gives the first number peeked slots back
+        // along with the pops of an unfinished batch; a pop in between
+        // drops the span
+        void release(uint64_t number)
+        {
+            assert(number <= m_peeked_number);
+            m_peeked_number = 0;
+            m_read_local += number;
+            m_read_published = m_read_local;
+            m_read.store(m_read_local, std::memory_order_release);
+        }
+
+        // consumer only
+        bool pop(value_type& val)
+        {
+            auto read = m_read_local;
+            if(read == m_cached_write)
+            {
+                m_cached_write = m_write.load(std::memory_order_acquire);
+                if(read == m_cached_write)
+                {
+                    // the producer must see everything to refill
+                    flush_pops();
+                    return false;
+                }
+            }
+            val = m_data[read & MASK];
+            m_read_local = ++read;
+            m_peeked_number = 0;
+            if(BATCH_SIZE == 1) m_read.store(read, std::memory_order_release);
+            else if(read - m_read_published >= BATCH_SIZE)
+            {
+                m_read_published = read;
+                m_read.store(read, std::memory_order_release);
             }
-            ++i_pop;
-            val = previous_value;
 
             return true;
         }
+        // consumer only, gives the slots of an unfinished batch back
+        void flush_pops()
+        {
+            if(BATCH_SIZE == 1 || m_read_published == m_read_local) return;
+            m_read_published = m_read_local;
+            m_read.store(m_read_local, std::memory_order_release);
+        }
 
     private:
-        std::array<std::atomic<value_type>, DATA_NUMBER> m_data = {};
-        char padding1[128 - sizeof(value_type)];
-        uint64_t i_push = 0;
-        char padding2[128 - sizeof i_push];
-        uint64_t i_pop = 0;
-        char padding3[128 - sizeof i_pop];
+        char padding1[128];
+        // the producer line, only written by the producer
+        uint64_t m_write_local = 0;
+        uint64_t m_write_published = 0;
+        uint64_t m_cached_read = 0;
+        uint64_t m_reserved_number = 0; // the last span, for commit
+        char padding2[128 - 4 * sizeof(uint64_t)];
+        // read by the consumer, written once per batch
+        std::atomic<uint64_t> m_write{0};
+        char padding3[128 - sizeof m_write];
+        // the consumer line, only written by the consumer
+        uint64_t m_read_local = 0;
+        uint64_t m_read_published = 0;
+        uint64_t m_cached_write = 0;
+        uint64_t m_peeked_number = 0; // the last span, for release
+        char padding4[128 - 4 * sizeof(uint64_t)];
+        // read by the producer, written once per batch
+        std::atomic<uint64_t> m_read{0};
+        char padding5[128 - sizeof m_read];
+        std::array<value_type, DATA_NUMBER> m_data;
+        char padding6[128];
     };
 	//
 }
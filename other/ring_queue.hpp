@@ -0,0 +1,122 @@
+#ifndef __OTHER_RING_QUEUE_HPP__
+#define __OTHER_RING_QUEUE_HPP__
+
+#include <cstdint>
+
+#include <atomic>
+#include <array>
+#include <type_traits>
+
+#include <boost/noncopyable.hpp>
+
+#include "../technical.hpp"
+
+
+
+namespace lock_free
+{
+    // bounded MPMC queue over an array of cells, no nodes are allocated;
+    // a cell sequence equal to the position means free for push, equal
+    // to the position + 1 means full for pop
+    template <
+        uint64_t Capacity,
+        typename T,
+        typename BackOff = basic_backoff
+    > class ring_queue: boost::noncopyable
+    {
+    public:
+        static_assert(
+            std::is_trivially_copyable<T>::value,
+            "T must be trivially copyable"
+        );
+        static_assert(
+            Capacity >= 2 && !(Capacity & (Capacity - 1)),
+            "Capacity must be a power of two"
+        );
+
+        static constexpr uint64_t CAPACITY = Capacity;
+        static constexpr uint64_t MASK = Capacity - 1;
+
+        using value_type = T;
+        using backoff_strategy_type = BackOff;
+
+        struct cell_type
+        {
+            std::atomic<uint64_t> sequence;
+            value_type value;
+        };
+
+    public:
+        ring_queue()
+        {
+            for(uint64_t i = 0; i < CAPACITY; ++i)
+                m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        // false if the queue is full
+        bool push(const value_type& val)
+        {
+            cell_type* cell = nullptr;
+            auto pos = m_enqueue_pos.load(std::memory_order_relaxed);
+            while(true)
+            {
+                cell = &m_cells[pos & MASK];
+                auto sequence = cell->sequence.load(std::memory_order_acquire);
+                auto diff = static_cast<int64_t>(sequence - pos);
+                if(!diff)
+                {
+                    if(m_enqueue_pos.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed
+                    )) break;
+                    m_backoff.wait();
+                }
+                else if(diff < 0) return false;
+                else pos = m_enqueue_pos.load(std::memory_order_relaxed);
+            }
+            cell->value = val;
+            cell->sequence.store(pos + 1, std::memory_order_release);
+
+            return true;
+        }
+
+        // false if the queue is empty
+        bool pop(value_type& val)
+        {
+            cell_type* cell = nullptr;
+            auto pos = m_dequeue_pos.load(std::memory_order_relaxed);
+            while(true)
+            {
+                cell = &m_cells[pos & MASK];
+                auto sequence = cell->sequence.load(std::memory_order_acquire);
+                auto diff = static_cast<int64_t>(sequence - (pos + 1));
+                if(!diff)
+                {
+                    if(m_dequeue_pos.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed
+                    )) break;
+                    m_backoff.wait();
+                }
+                else if(diff < 0) return false;
+                else pos = m_dequeue_pos.load(std::memory_order_relaxed);
+            }
+            val = cell->value;
+            // the cell is free for the push of the next lap
+            cell->sequence.store(pos + CAPACITY, std::memory_order_release);
+
+            return true;
+        }
+
+    private:
+        char padding1[128];
+        std::array<cell_type, CAPACITY> m_cells;
+        char padding2[128];
+        std::atomic<uint64_t> m_enqueue_pos{0};
+        char padding3[128 - sizeof m_enqueue_pos];
+        std::atomic<uint64_t> m_dequeue_pos{0};
+        char padding4[128 - sizeof m_dequeue_pos];
+        backoff_strategy_type m_backoff;
+    };
+    //
+}
+
+#endif // __OTHER_RING_QUEUE_HPP__
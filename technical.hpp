@@ -3,6 +3,9 @@
 
 #include <cstdint>
 #include <cassert>
+#include <cerrno>
+#include <climits>
+#include <ctime>
 
 #include <atomic>
 #include <random>
@@ -16,6 +19,23 @@
 #include <chrono>
 #include <type_traits>
 #include <tuple>
+#include <mutex>
+#include <functional>
+#include <stdexcept>
+#include <condition_variable>
+#include <new>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <linux/membarrier.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
 
 #include <boost/noncopyable.hpp>
 
@@ -110,6 +130,159 @@ namespace lock_free
     };
 
 
+    // no elimination layer, the default for the stacks
+    struct no_elimination
+    {
+        template <typename T>
+        bool try_push(const T&) { return false; }
+        template <typename T>
+        bool try_pop(T&) { return false; }
+    };
+
+    // a push and a pop colliding on the stack head exchange the value
+    // in a random slot: the push waits there for SPINS_NUMBER iterations,
+    // the pop never waits. The used width shrinks when pushes time out
+    // and grows when they find occupied slots. The state of a slot is
+    // the phase and the sequence number of the push that owns it: a pop
+    // reads the value and takes it by one CAS from FULL to TAKEN, so it
+    // fails if the push has withdrawn meanwhile, and the withdraw CAS
+    // of the push settles the race with a pop, nobody waits for another
+    template <typename T, uint64_t MaxWidth = 16>
+    class elimination_array: boost::noncopyable
+    {
+    public:
+        static_assert(
+            std::is_trivially_copyable<T>::value,
+            "T must be trivially copyable"
+        );
+
+        static constexpr uint64_t MAX_WIDTH = MaxWidth;
+        static constexpr uint64_t SPINS_NUMBER = 256;
+        static constexpr uint64_t EMPTY = 0;
+        static constexpr uint64_t WRITING = 1; // a push writes the value
+        static constexpr uint64_t FULL = 2; // a push waits
+        static constexpr uint64_t TAKEN = 3; // a pop took the value
+        static constexpr uint64_t PHASE_MASK = 3;
+        static constexpr uint64_t SEQUENCE_STEP = 4;
+
+        using value_type = T;
+
+        struct slot_type
+        {
+            slot_type(): state(EMPTY) {}
+
+            std::atomic<uint64_t> state;
+            value_type value;
+            char padding[
+                128 - (sizeof(std::atomic<uint64_t>) + sizeof(value_type)) % 128
+            ];
+        };
+
+    public:
+        elimination_array(): m_width(1) {}
+
+        bool try_push(const value_type& val)
+        {
+            auto& slot = m_slots[get_random() % get_width()];
+            uint64_t state = slot.state.load(std::memory_order_relaxed);
+            uint64_t sequence = (state & ~PHASE_MASK) + SEQUENCE_STEP;
+            if((state & PHASE_MASK) != EMPTY ||
+               !slot.state.compare_exchange_strong(
+                   state, sequence | WRITING, std::memory_order_acquire
+               )
+            ) {
+                grow();
+                return false;
+            }
+            slot.value = val;
+            slot.state.store(sequence | FULL, std::memory_order_release);
+
+            for(uint64_t i = 0; i < SPINS_NUMBER; ++i)
+            {
+                if(slot.state.load(std::memory_order_acquire) ==
+                   (sequence | TAKEN)
+                ) {
+                    slot.state.store(
+                        sequence | EMPTY, std::memory_order_release
+                    );
+                    return true;
+                }
+#ifdef __x86_64__
+                __asm__("pause");
+#endif
+            }
+
+            // only a pop changes FULL, so a failure means TAKEN
+            state = sequence | FULL;
+            if(slot.state.compare_exchange_strong(
+                state, sequence | EMPTY, std::memory_order_acq_rel
+            )) {
+                shrink();
+                return false;
+            }
+            assert(state == (sequence | TAKEN));
+            slot.state.store(sequence | EMPTY, std::memory_order_release);
+            return true;
+        }
+        // the value may be read while the push withdraws and another one
+        // writes, the failed CAS drops it then
+        bool try_pop(value_type& val)
+        {
+            auto& slot = m_slots[get_random() % get_width()];
+            uint64_t state = slot.state.load(std::memory_order_acquire);
+            if((state & PHASE_MASK) != FULL) return false;
+            value_type tmp = slot.value;
+            if(!slot.state.compare_exchange_strong(
+                state,
+                (state & ~PHASE_MASK) | TAKEN,
+                std::memory_order_acq_rel
+            )) return false;
+            val = tmp;
+            return true;
+        }
+
+    private:
+        static uint64_t get_random()
+        {
+            static thread_local uint64_t state =
+                std::hash<std::thread::id>()(std::this_thread::get_id()) | 1;
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            return state;
+        }
+        uint64_t get_width() const
+        {
+            return m_width.load(std::memory_order_relaxed);
+        }
+        void grow()
+        {
+            auto width = get_width();
+            if(width < MAX_WIDTH)
+            {
+                m_width.compare_exchange_strong(
+                    width, width + 1, std::memory_order_relaxed
+                );
+            }
+        }
+        void shrink()
+        {
+            auto width = get_width();
+            if(width > 1)
+            {
+                m_width.compare_exchange_strong(
+                    width, width - 1, std::memory_order_relaxed
+                );
+            }
+        }
+
+    private:
+        std::atomic<uint64_t> m_width;
+        char padding[128 - sizeof m_width];
+        std::array<slot_type, MAX_WIDTH> m_slots;
+    };
+
+
     using tagged_pointer = void*;
 
     struct tptrs
@@ -120,6 +293,9 @@ namespace lock_free
         // at 64 bit appropriate aligned pointers 3 least bits are zero
         static constexpr uint64_t CLEAR_INFO_BITS = ~0x7;
 
+        using tagged_type = tagged_pointer;
+        using atomic_type = std::atomic<tagged_type>;
+
         static void* get_pointer(tagged_pointer val, bool clear_info_bits)
         noexcept
         {
@@ -168,22 +344,454 @@ namespace lock_free
         {
             return set(get_pointer(val, false), get_counter(val) + 1);
         }
+        static bool is_null(tagged_pointer val) noexcept
+        {
+            return !get_pointer(val, false);
+        }
+    };
+
+#ifdef __GCC_HAVE_SYNC_COMPARE_AND_SWAP_16 // -mcx16
+    struct alignas(16) wide_tagged_pointer
+    {
+        void* ptr;
+        uint64_t counter;
+    };
+    inline bool operator==(
+        const wide_tagged_pointer& lhs, const wide_tagged_pointer& rhs
+    ) noexcept
+    {
+        return lhs.ptr == rhs.ptr && lhs.counter == rhs.counter;
+    }
+    inline bool operator!=(
+        const wide_tagged_pointer& lhs, const wide_tagged_pointer& rhs
+    ) noexcept
+    {
+        return !(lhs == rhs);
+    }
+
+    // subset of std::atomic on cmpxchg16b; load and store are done by
+    // cmpxchg16b too, the halves read separately could pair the pointer
+    // of a node with a counter the stack head reaches with it later
+    class atomic_wide_tagged_pointer: boost::noncopyable
+    {
+    public:
+        atomic_wide_tagged_pointer(
+            wide_tagged_pointer val = wide_tagged_pointer()
+        ) noexcept
+        {
+            m_value.tagged = val;
+        }
+
+        wide_tagged_pointer load(
+            std::memory_order /*order*/ = std::memory_order_seq_cst
+        ) const noexcept
+        {
+            // the swap of 0 with 0 writes back what it has read
+            value_type ret;
+            ret.whole = __sync_val_compare_and_swap(
+                &m_value.whole, uint128_type(0), uint128_type(0)
+            );
+            return ret.tagged;
+        }
+        void store(
+            wide_tagged_pointer val,
+            std::memory_order /*order*/ = std::memory_order_seq_cst
+        ) noexcept
+        {
+            auto expected = load();
+            while(!compare_exchange_strong(expected, val));
+        }
+        // cmpxchg16b is a full barrier, order is ignored
+        bool compare_exchange_strong(
+            wide_tagged_pointer& expected,
+            wide_tagged_pointer desired,
+            std::memory_order /*order*/ = std::memory_order_seq_cst
+        ) noexcept
+        {
+            value_type exp, des, prev;
+            exp.tagged = expected;
+            des.tagged = desired;
+            prev.whole = __sync_val_compare_and_swap(
+                &m_value.whole, exp.whole, des.whole
+            );
+            if(prev.whole == exp.whole) return true;
+            expected = prev.tagged;
+            return false;
+        }
+        bool compare_exchange_weak(
+            wide_tagged_pointer& expected,
+            wide_tagged_pointer desired,
+            std::memory_order order = std::memory_order_seq_cst
+        ) noexcept
+        {
+            return compare_exchange_strong(expected, desired, order);
+        }
+
+    private:
+        __extension__ typedef unsigned __int128 uint128_type;
+        union value_type
+        {
+            uint128_type whole;
+            wide_tagged_pointer tagged;
+        };
+
+        mutable value_type m_value;
     };
 
+    // {pointer, 64 bit counter}, the counter doesn't wrap and
+    // the pointer may use all 64 bits (57 bit address kernels)
+    struct wide_tptrs
+    {
+        using tagged_type = wide_tagged_pointer;
+        using atomic_type = atomic_wide_tagged_pointer;
 
-    template <typename T>
+        static void* get_pointer(tagged_type val, bool /*clear_info_bits*/)
+        noexcept
+        {
+            return val.ptr;
+        }
+        template <typename T>
+        static T get_pointer(tagged_type val, bool clear_info_bits = false)
+        noexcept
+        {
+            static_assert(
+                std::is_pointer<T>::value,
+                "T must be pointer type"
+            );
+            return static_cast<T>( get_pointer(val, clear_info_bits) );
+        }
+        static uint64_t get_counter(tagged_type val) noexcept
+        {
+            return val.counter;
+        }
+        static tagged_type set(void* ptr, uint64_t cnt) noexcept
+        {
+            return tagged_type{ptr, cnt};
+        }
+        static tagged_type increment(tagged_type val) noexcept
+        {
+            return set(val.ptr, val.counter + 1);
+        }
+        static bool is_null(tagged_type val) noexcept
+        {
+            return !val.ptr;
+        }
+    };
+#endif
+
+    // nodes live in a contiguous arena of Capacity nodes per node type,
+    // a link is one 64 bit word: 32 bit index + 1 (0 is null) and
+    // 32 bit counter. Containers with the same node type and Tag share
+    // the arena; freed nodes are reused by single node allocations and
+    // the whole arena is reset when its last allocator is destroyed.
+    // tp containers keep their nodes to the end and free them all in
+    // their destructors
+    template <uint64_t Capacity, typename Tag = void>
+    struct index_tptrs
+    {
+        static_assert(
+            Capacity < 0xFFFFFFFF,
+            "index + 1 must fit 32 bits"
+        );
+
+        static constexpr uint64_t CAPACITY = Capacity;
+        static constexpr uint64_t INDEX_BITS = 32;
+        static constexpr uint64_t INDEX_MASK = 0xFFFFFFFF;
+
+        using tagged_type = uint64_t;
+        using atomic_type = std::atomic<tagged_type>;
+
+        // use as Allocator of the container
+        template <typename U>
+        class allocator
+        {
+        public:
+            using value_type = U;
+            using pointer = U*;
+            using size_type = size_t;
+
+            template <typename V>
+            struct rebind
+            {
+                using other = allocator<V>;
+            };
+
+            // the containers hold the allocators, so the arena is
+            // unused once the last one is gone
+            allocator()
+            {
+                auto& state = get_state();
+                std::lock_guard<std::mutex> lck(state.lock);
+                ++state.instances;
+            }
+            allocator(const allocator&): allocator() {}
+            template <typename V>
+            allocator(const allocator<V>&): allocator() {}
+            ~allocator()
+            {
+                auto& state = get_state();
+                std::lock_guard<std::mutex> lck(state.lock);
+                if(--state.instances) return;
+                state.next = 0;
+                state.free_nodes.clear();
+            }
+
+            U* allocate(size_t n)
+            {
+                auto& state = get_state();
+                std::lock_guard<std::mutex> lck(state.lock);
+                if(n == 1 && !state.free_nodes.empty())
+                {
+                    auto ptr = state.free_nodes.back();
+                    state.free_nodes.pop_back();
+                    return ptr;
+                }
+                if(state.next + n > CAPACITY) throw std::bad_alloc();
+                auto ptr = get_arena() + state.next;
+                state.next += n;
+                return ptr;
+            }
+            void deallocate(U* ptr, size_t n)
+            {
+                auto& state = get_state();
+                std::lock_guard<std::mutex> lck(state.lock);
+                for(size_t i = 0; i < n; ++i) state.free_nodes.push_back(ptr + i);
+            }
+
+            template <typename ... Args>
+            void construct(U* ptr, Args&& ... args)
+            {
+                new(ptr) U(std::forward<Args>(args)...);
+            }
+            void destroy(U* ptr)
+            {
+                ptr->~U();
+            }
+
+            static U* get_arena()
+            {
+                using storage_type = typename std::aligned_storage<
+                    sizeof(U), alignof(U)
+                >::type;
+                static const std::unique_ptr<storage_type[]> arena(
+                    new storage_type[CAPACITY]
+                );
+                return reinterpret_cast<U*>(arena.get());
+            }
+
+        private:
+            struct state_type
+            {
+                std::mutex lock;
+                uint64_t instances = 0;
+                uint64_t next = 0;
+                std::vector<U*> free_nodes;
+            };
+
+            static state_type& get_state()
+            {
+                static state_type state;
+                return state;
+            }
+        };
+
+        template <typename T>
+        static T get_pointer(tagged_type val, bool /*clear_info_bits*/ = false)
+        noexcept
+        {
+            static_assert(
+                std::is_pointer<T>::value,
+                "T must be pointer type"
+            );
+            using node_type = typename std::remove_pointer<T>::type;
+            auto index = val & INDEX_MASK;
+            if(!index) return nullptr;
+            return allocator<node_type>::get_arena() + index - 1;
+        }
+        static uint32_t get_counter(tagged_type val) noexcept
+        {
+            return static_cast<uint32_t>(val >> INDEX_BITS);
+        }
+        template <typename U>
+        static tagged_type set(U* ptr, uint32_t cnt) noexcept
+        {
+            uint64_t index = ptr ? ptr - allocator<U>::get_arena() + 1 : 0;
+            return (static_cast<uint64_t>(cnt) << INDEX_BITS) | index;
+        }
+        static tagged_type increment(tagged_type val) noexcept
+        {
+            return (val & INDEX_MASK) |
+                (static_cast<uint64_t>(get_counter(val) + 1) << INDEX_BITS);
+        }
+        static bool is_null(tagged_type val) noexcept
+        {
+            return !(val & INDEX_MASK);
+        }
+    };
+
+    // the node allocator of a container must be the arena of its
+    // index_tptrs, other tptrs keep real pointers
+    template <typename Tptrs, typename Allocator>
+    struct is_tptrs_allocator: std::true_type {};
+
+    template <uint64_t Capacity, typename Tag, typename Allocator>
+    struct is_tptrs_allocator<index_tptrs<Capacity, Tag>, Allocator>:
+        std::is_same<
+            Allocator,
+            typename index_tptrs<Capacity, Tag>::template allocator<
+                typename Allocator::value_type
+            >
+        >
+    {};
+
+
+    // large allocations are mapped directly and pre-faulted, so a pool
+    // carved from one allocate(n) is contiguous and ready before the
+    // first operation; HugePages asks for transparent huge pages
+    template <typename T, bool HugePages = false>
+    class slab_allocator
+    {
+    public:
+        static constexpr size_t SLAB_THRESHOLD = 64 * 1024;
+        static constexpr size_t PAGE_SIZE = 4096;
+        static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+        using value_type = T;
+        using pointer = T*;
+        using size_type = size_t;
+
+        template <typename U>
+        struct rebind
+        {
+            using other = slab_allocator<U, HugePages>;
+        };
+
+        slab_allocator() = default;
+        template <typename U>
+        slab_allocator(const slab_allocator<U, HugePages>&) noexcept {}
+
+        T* allocate(size_t n)
+        {
+            size_t size = n * sizeof(T);
+            if(size < SLAB_THRESHOLD)
+                return static_cast<T*>(::operator new(size));
+#ifdef __linux__
+            size = get_mapping_size(size);
+            int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+            // the pages must be advised before they are faulted in
+            if(!HugePages) flags |= MAP_POPULATE;
+            void* ptr = mmap(
+                nullptr, size, PROT_READ | PROT_WRITE, flags, -1, 0
+            );
+            if(ptr == MAP_FAILED) throw std::bad_alloc();
+            if(HugePages)
+            {
+                madvise(ptr, size, MADV_HUGEPAGE);
+                prefault(ptr, size);
+            }
+            return static_cast<T*>(ptr);
+#else
+            void* ptr = ::operator new(size);
+            prefault(ptr, size);
+            return static_cast<T*>(ptr);
+#endif
+        }
+        void deallocate(T* ptr, size_t n) noexcept
+        {
+            size_t size = n * sizeof(T);
+#ifdef __linux__
+            if(size >= SLAB_THRESHOLD)
+            {
+                munmap(ptr, get_mapping_size(size));
+                return;
+            }
+#endif
+            ::operator delete(ptr);
+        }
+
+        template <typename ... Args>
+        void construct(T* ptr, Args&& ... args)
+        {
+            new(ptr) T(std::forward<Args>(args)...);
+        }
+        void destroy(T* ptr)
+        {
+            ptr->~T();
+        }
+
+    private:
+        static size_t get_mapping_size(size_t size)
+        {
+            size_t align = HugePages ? HUGE_PAGE_SIZE : PAGE_SIZE;
+            return (size + align - 1) / align * align;
+        }
+        static void prefault(void* ptr, size_t size)
+        {
+            auto bytes = static_cast<volatile char*>(ptr);
+            for(size_t i = 0; i < size; i += PAGE_SIZE) bytes[i] = 0;
+        }
+    };
+
+    template <typename T, typename U, bool HugePages>
+    bool operator==(
+        const slab_allocator<T, HugePages>&, const slab_allocator<U, HugePages>&
+    ) noexcept
+    {
+        return true;
+    }
+    template <typename T, typename U, bool HugePages>
+    bool operator!=(
+        const slab_allocator<T, HugePages>&, const slab_allocator<U, HugePages>&
+    ) noexcept
+    {
+        return false;
+    }
+
+
+    template <typename T, typename Tptrs = tptrs>
     struct node
     {
         using value_type = T;
+        using tagged_type = typename Tptrs::tagged_type;
 
-        node(): next(nullptr), value(value_type()) {}
-        node(const value_type& val): next(nullptr), value(val) {}
-        node(tagged_pointer ptr, const value_type& val):
+        node(): next(tagged_type()), value(value_type()) {}
+        node(const value_type& val): next(tagged_type()), value(val) {}
+        node(tagged_type ptr, const value_type& val):
             next(ptr),
             value(val)
         {}
 
-        std::atomic<tagged_pointer> next;
+        // a null with the next counter, a CAS of a stale reader that
+        // still expects the old null fails once the node is reused
+        void reset_next(std::memory_order order = std::memory_order_relaxed)
+        {
+            auto ptr = next.load(std::memory_order_relaxed);
+            next.store(
+                Tptrs::set(
+                    static_cast<node*>(nullptr), Tptrs::get_counter(ptr) + 1
+                ),
+                order
+            );
+        }
+
+        // the counted form of Michael-Scott: a CAS on next, head or tail
+        // stores ptr with the counter of the expected value + 1, so none
+        // of them takes an old value again and a stale CAS fails
+        static tagged_type link(tagged_type expected, tagged_type ptr)
+        {
+            return Tptrs::set(
+                Tptrs::template get_pointer<node*>(ptr),
+                Tptrs::get_counter(expected) + 1
+            );
+        }
+        // head and tail have their own counters, only the nodes compare
+        static bool is_same(tagged_type lhs, tagged_type rhs)
+        {
+            return Tptrs::template get_pointer<node*>(lhs) ==
+                Tptrs::template get_pointer<node*>(rhs);
+        }
+
+        typename Tptrs::atomic_type next;
         value_type value;
     };
 
@@ -197,31 +805,43 @@ namespace lock_free
 
         std::atomic<hp_node*> next;
         value_type value;
+        uint64_t birth_era = 0; // for ibr_manager
+        uint64_t retire_era = 0;
     };
     
     
-    template <typename NodeType, typename BackOff>
+    template <typename NodeType, typename BackOff, typename Tptrs = tptrs>
     class stack_nodes_holder: boost::noncopyable
     {
     public:
         using node_type = NodeType;
         using value_type = typename NodeType::value_type;
         using backoff_strategy_type = BackOff;
+        using tptrs_type = Tptrs;
+        using tagged_type = typename tptrs_type::tagged_type;
 
         static_assert(
             std::is_trivially_copyable<value_type>::value,
             "value_type must be trivially copyable"
         );
 
-        stack_nodes_holder(): m_head(nullptr) {}
-        stack_nodes_holder(node_type* ptr): m_head(ptr)
+        stack_nodes_holder(): m_head(tagged_type()) {}
+        stack_nodes_holder(node_type* ptr): m_head(tptrs_type::set(ptr, 0))
         {
-            assert(ptr->next == nullptr);
+            assert(tptrs_type::is_null(ptr->next.load()));
         }
         void init(node_type* ptr)
         {
-            m_head.store(ptr, std::memory_order_relaxed);
-            assert(ptr->next == nullptr);
+            m_head.store(tptrs_type::set(ptr, 0), std::memory_order_relaxed);
+            assert(tptrs_type::is_null(ptr->next.load()));
+        }
+        // for the destructor of the owner, the free nodes are linked
+        // from it up to a null next
+        node_type* get_head() const
+        {
+            return tptrs_type::template get_pointer<node_type*>(
+                m_head.load(std::memory_order_acquire), true
+            );
         }
         /*
         node_type* extract_head()
@@ -232,66 +852,67 @@ namespace lock_free
             return static_cast<node_type*>(head);
         }
         */
-        node_type* get_node(void* ptr, const value_type& val)
+        tagged_type get_node(tagged_type ptr, const value_type& val)
         {
             auto node_ptr = get_node(val);
-            if(!node_ptr) return nullptr;
-            tptrs::get_pointer<node_type*>(node_ptr)->next.store(
+            if(tptrs_type::is_null(node_ptr)) return node_ptr;
+            tptrs_type::template get_pointer<node_type*>(node_ptr)->next.store(
                 ptr, std::memory_order_relaxed
             );
             return node_ptr;
         }
-        node_type* get_node(const value_type& val)
+        tagged_type get_node(const value_type& val, uint64_t* retries = nullptr)
         {
-            auto node_ptr = get_node();
-            if(!node_ptr) return nullptr;
-            tptrs::get_pointer<node_type*>(node_ptr)->value = val;
+            auto node_ptr = get_node(retries);
+            if(tptrs_type::is_null(node_ptr)) return node_ptr;
+            tptrs_type::template get_pointer<node_type*>(node_ptr)->value = val;
             return node_ptr;
         }
-        node_type* get_node()
+        // the failed CAS are added to retries if given
+        tagged_type get_node(uint64_t* retries = nullptr)
         {
             auto head = m_head.load(std::memory_order_consume);
-            assert(head != nullptr);
+            assert(!tptrs_type::is_null(head));
 
-            node_type* node_ptr = nullptr;
+            tagged_type node_ptr = tagged_type();
             while(true)
             {
-                auto next = tptrs::get_pointer<node_type*>(head, true)->next.load(
-                    std::memory_order_relaxed
-                );
-                if(!next) break;
+                auto next = tptrs_type::template get_pointer<node_type*>(
+                    head, true
+                )->next.load(std::memory_order_relaxed);
+                if(tptrs_type::is_null(next)) break;
 
                 if (m_head.compare_exchange_strong(
                     head,
                     next,
                     std::memory_order_acq_rel
                 )) {
-                    head = tptrs::increment(head);
-                    node_ptr = static_cast<node_type*>(head);
+                    node_ptr = tptrs_type::increment(head);
                     break;
                 }
+                if(retries) ++*retries;
                 m_backoff.wait();
             }
 
             return node_ptr;
         }
 
-        bool save_node(node_type* ptr)
+        bool save_node(tagged_type ptr, uint64_t* retries = nullptr)
         {
             while(true)
             {
                 auto head = m_head.load(std::memory_order_consume);
-                assert(head != nullptr);
+                assert(!tptrs_type::is_null(head));
 
-                tptrs::get_pointer<node_type*>(ptr, true)->next.store(
-                    static_cast<node_type*>(head),
-                    std::memory_order_relaxed
-                );
+                tptrs_type::template get_pointer<node_type*>(
+                    ptr, true
+                )->next.store(head, std::memory_order_relaxed);
                 if(m_head.compare_exchange_strong(
                     head,
                     ptr,
                     std::memory_order_acq_rel
                 )) break;
+                if(retries) ++*retries;
                 m_backoff.wait();
             }
 
@@ -299,80 +920,100 @@ namespace lock_free
         }
 
     private:
-        std::atomic<tagged_pointer> m_head;
+        typename tptrs_type::atomic_type m_head;
         backoff_strategy_type m_backoff;
     };
 
-    template <typename NodeType, typename BackOff>
+    template <typename NodeType, typename BackOff, typename Tptrs = tptrs>
     class queue_nodes_holder: boost::noncopyable
     {
     public:
         using node_type = NodeType;
         using value_type = typename NodeType::value_type;
         using backoff_strategy_type = BackOff;
+        using tptrs_type = Tptrs;
+        using tagged_type = typename tptrs_type::tagged_type;
+        using atomic_type = typename tptrs_type::atomic_type;
 
         static_assert(
             std::is_trivially_copyable<value_type>::value,
             "value_type must be trivially copyable"
         );
 
-        queue_nodes_holder(): m_head(nullptr), m_tail(nullptr) {}
+        queue_nodes_holder(): m_head(tagged_type()), m_tail(tagged_type()) {}
         queue_nodes_holder(node_type* ptr):
-            m_head(ptr), m_tail(ptr)
+            m_head(tptrs_type::set(ptr, 0)), m_tail(tptrs_type::set(ptr, 0))
         {
-            assert(ptr->next == nullptr);
+            assert(tptrs_type::is_null(ptr->next.load()));
         }
         void init(node_type* ptr)
         {
-            m_head.store(ptr, std::memory_order_relaxed);
-            m_tail.store(ptr, std::memory_order_relaxed);
-            assert(ptr->next == nullptr);
+            m_head.store(tptrs_type::set(ptr, 0), std::memory_order_relaxed);
+            m_tail.store(tptrs_type::set(ptr, 0), std::memory_order_relaxed);
+            assert(tptrs_type::is_null(ptr->next.load()));
+        }
+        // for the destructor of the owner, the free nodes are linked
+        // from it up to a null next
+        node_type* get_head() const
+        {
+            return tptrs_type::template get_pointer<node_type*>(
+                m_head.load(std::memory_order_acquire)
+            );
         }
 
-        node_type* get_node(void* ptr, const value_type& val)
+        tagged_type get_node(tagged_type ptr, const value_type& val)
         {
             auto node_ptr = get_node(val);
-            if(!node_ptr) return nullptr;
-            tptrs::get_pointer<node_type*>(node_ptr)->next.store(
+            if(tptrs_type::is_null(node_ptr)) return node_ptr;
+            tptrs_type::template get_pointer<node_type*>(node_ptr)->next.store(
                 ptr, std::memory_order_relaxed
             );
             return node_ptr;
         }
-        node_type* get_node(const value_type& val)
+        tagged_type get_node(const value_type& val, uint64_t* retries = nullptr)
         {
-            auto node_ptr = get_node();
-            if(!node_ptr) return nullptr;
-            tptrs::get_pointer<node_type*>(node_ptr)->value = val;
+            auto node_ptr = get_node(retries);
+            if(tptrs_type::is_null(node_ptr)) return node_ptr;
+            tptrs_type::template get_pointer<node_type*>(node_ptr)->value = val;
             return node_ptr;
         }
-        node_type* get_node() // pop
+        // the failed CAS are added to retries if given
+        tagged_type get_node(uint64_t* retries = nullptr) // pop
         {
             while(true)
             {
                 auto head = m_head.load(std::memory_order_consume);
                 auto tail = m_tail.load(std::memory_order_consume);
-                auto hnext = tptrs::get_pointer<node_type*>(head)->next.load(
-                    std::memory_order_acquire
-                );
-                //if(head != m_head.load(std::memory_order_seq_cst)) continue;
+                auto hnext = tptrs_type::template get_pointer<node_type*>(
+                    head
+                )->next.load(std::memory_order_acquire);
+                if(head != m_head.load(std::memory_order_acquire)) continue;
 
-                if (head == tail)
+                if (node_type::is_same(head, tail))
                 {
-                    if(!hnext)
+                    if(tptrs_type::is_null(hnext))
                     {
-                        return nullptr;
+                        return tagged_type();
                     }
                     if(!m_tail.compare_exchange_strong(
-                        tail, hnext, std::memory_order_release
-                    )) m_backoff.wait();
+                        tail,
+                        node_type::link(tail, hnext),
+                        std::memory_order_release
+                    )) {
+                        if(retries) ++*retries;
+                        m_backoff.wait();
+                    }
                 }
                 else {
+                    if(tptrs_type::is_null(hnext)) continue;
                     if(m_head.compare_exchange_strong(
-                        head, hnext, std::memory_order_acq_rel
+                        head,
+                        node_type::link(head, hnext),
+                        std::memory_order_acq_rel
                     )) {
-                        head = tptrs::increment(head);
-                        return static_cast<node_type*>(head);
+                        return tptrs_type::increment(head);
                     }
+                    if(retries) ++*retries;
                     m_backoff.wait();
                 }
                 //
@@ -380,39 +1021,48 @@ namespace lock_free
             //
         }
 
-        bool save_node(node_type* ptr) // push
+        bool save_node(tagged_type ptr, uint64_t* retries = nullptr) // push
         {
-            tptrs::get_pointer<node_type*>(ptr)->next.store(
-                nullptr, std::memory_order_seq_cst
+            tptrs_type::template get_pointer<node_type*>(ptr)->reset_next(
+                std::memory_order_seq_cst
             );
             while(true)
             {
                 auto tail = m_tail.load(std::memory_order_consume);
-                assert(tail != nullptr);
-                auto next = tptrs::get_pointer<node_type*>(tail)->next.load(
-                    std::memory_order_consume
-                );
+                assert(!tptrs_type::is_null(tail));
+                auto next = tptrs_type::template get_pointer<node_type*>(
+                    tail
+                )->next.load(std::memory_order_consume);
                 //if(tail != m_tail.load(std::memory_order_acquire)) continue;
 
-                if(!next)
+                if(tptrs_type::is_null(next))
                 {
-                    auto tail_ptr = tptrs::get_pointer<node_type*>(tail);
+                    auto tail_ptr =
+                        tptrs_type::template get_pointer<node_type*>(tail);
                     if(tail_ptr->next.compare_exchange_strong(
                         next,
-                        ptr,
+                        node_type::link(next, ptr),
                         std::memory_order_acq_rel
                     )) {
                         m_tail.compare_exchange_strong(
-                            tail, ptr, std::memory_order_release
+                            tail,
+                            node_type::link(tail, ptr),
+                            std::memory_order_release
                         );
                         break;
                     }
+                    if(retries) ++*retries;
                     m_backoff.wait();
                 }
                 else {
                     if(!m_tail.compare_exchange_strong(
-                        tail, next, std::memory_order_release
-                    )) m_backoff.wait();
+                        tail,
+                        node_type::link(tail, next),
+                        std::memory_order_release
+                    )) {
+                        if(retries) ++*retries;
+                        m_backoff.wait();
+                    }
                 }
                 //
             }
@@ -421,31 +1071,198 @@ namespace lock_free
         }
 
     private:
-        char padding1[128 - sizeof(std::atomic<tagged_pointer>)];
-        std::atomic<tagged_pointer> m_head;
+        char padding1[128 - sizeof(atomic_type)];
+        atomic_type m_head;
         char padding2[128 - sizeof m_head];
-        std::atomic<tagged_pointer> m_tail;
+        atomic_type m_tail;
         char padding3[128 - sizeof m_tail];
         backoff_strategy_type m_backoff;
     };
 
-
-    template <typename Allocator>
-    class allocator_holder
+    // per thread LIFO caches of free nodes in front of the nodes holders,
+    // full magazines are exchanged with the depot as a whole; the depot
+    // is only try_locked, the holders are the lock-free fallback.
+    // A thread's magazines are reachable by it only, so they are flushed
+    // at thread exit and a pool too small for them doesn't use them
+    template <
+        typename Tptrs,
+        uint64_t MaxThreadsNumber,
+        uint64_t MagazineSize = 64,
+        uint64_t DepotSize = MaxThreadsNumber
+    > class node_magazines: boost::noncopyable
     {
     public:
-        using allocator_type = Allocator;
-        using node_type = typename Allocator::value_type;
-        using value_type = typename node_type::value_type;
+        static constexpr uint64_t MAX_THREADS_NUMBER = MaxThreadsNumber;
+        static constexpr uint64_t MAGAZINE_SIZE = MagazineSize;
+        static constexpr uint64_t DEPOT_SIZE = DepotSize;
+        // the most nodes the other threads may keep from a pool
+        static constexpr uint64_t MAX_CACHED_NODES =
+            MAX_THREADS_NUMBER * 2 * MAGAZINE_SIZE;
 
-    public:
-        node_type* allocate_and_construct()
+        using tptrs_type = Tptrs;
+        using tagged_type = typename tptrs_type::tagged_type;
+
+        struct magazine_type
         {
-            auto ptr = m_allocator.allocate(1);
-            m_allocator.construct(ptr);
-            return ptr;
-        }
-        node_type* allocate_and_construct(value_type const& val)
+            uint64_t size = 0;
+            std::array<tagged_type, MAGAZINE_SIZE> nodes;
+        };
+        // the previous magazine avoids depot trips at the magazine boundary
+        struct perthread_data_type
+        {
+            magazine_type loaded;
+            magazine_type previous;
+            char padding[128 - (2 * sizeof(magazine_type)) % 128];
+        };
+
+    public:
+        // the magazines are off if the nodes limit of the pool is
+        // reachable with the nodes cached by the threads
+        void init(uint64_t max_nodes_number, uint64_t buckets_number)
+        {
+            m_enabled = max_nodes_number >=
+                (MAX_CACHED_NODES + buckets_number - 1) / buckets_number;
+        }
+        // the nodes a pool with blocking pushes gets on top of its limit
+        // for the thread caches
+        uint64_t get_cached_nodes_number(uint64_t buckets_number) const
+        {
+            if(!m_enabled) return 0;
+            return (MAX_CACHED_NODES + buckets_number - 1) / buckets_number;
+        }
+
+        // the node counter is incremented as the holders do on reuse
+        tagged_type get_node(uint64_t thread_index)
+        {
+            if(!m_enabled) return tagged_type();
+            auto& data = m_thread_data[thread_index];
+            if(!data.loaded.size)
+            {
+                if(data.previous.size == MAGAZINE_SIZE)
+                    std::swap(data.loaded, data.previous);
+                else if(!take_full(data.loaded)) return tagged_type();
+            }
+            return tptrs_type::increment(
+                data.loaded.nodes[--data.loaded.size]
+            );
+        }
+        // false if the node has to go to the nodes holders
+        bool save_node(uint64_t thread_index, tagged_type ptr)
+        {
+            if(!m_enabled) return false;
+            auto& data = m_thread_data[thread_index];
+            if(data.loaded.size == MAGAZINE_SIZE)
+            {
+                if(!data.previous.size)
+                    std::swap(data.loaded, data.previous);
+                else if(put_full(data.previous))
+                    std::swap(data.loaded, data.previous);
+                else return false;
+            }
+            data.loaded.nodes[data.loaded.size++] = ptr;
+            return true;
+        }
+
+        // by the owner at thread exit, both magazines are emptied
+        void flush(uint64_t thread_index, std::vector<tagged_type>& nodes)
+        {
+            auto& data = m_thread_data[thread_index];
+            magazine_type* magazines[] = {&data.loaded, &data.previous};
+            for(auto magazine : magazines)
+            {
+                nodes.insert(
+                    nodes.end(),
+                    magazine->nodes.begin(),
+                    magazine->nodes.begin() + magazine->size
+                );
+                magazine->size = 0;
+            }
+        }
+        // one full magazine for a pool at its limit, try_locked as the
+        // magazine exchanges are; false if none could be taken
+        bool take_magazine(magazine_type& magazine)
+        {
+            return take_full(magazine);
+        }
+        // the whole depot under the lock, for trimming and destruction
+        // only, the operations never block on it
+        void take_depot(std::vector<tagged_type>& nodes)
+        {
+            if(!m_depot_size.load(std::memory_order_relaxed)) return;
+            std::lock_guard<std::mutex> lck(m_depot_lock);
+            auto size = m_depot_size.load(std::memory_order_relaxed);
+            for(uint64_t i = 0; i < size; ++i)
+            {
+                auto& magazine = m_depot[i];
+                nodes.insert(
+                    nodes.end(),
+                    magazine.nodes.begin(),
+                    magazine.nodes.begin() + magazine.size
+                );
+            }
+            m_depot_size.store(0, std::memory_order_relaxed);
+        }
+
+    private:
+        // the size is checked before the lock, a growing pool
+        // mustn't pay for the depot at every node
+        bool take_full(magazine_type& magazine)
+        {
+            if(!m_depot_size.load(std::memory_order_relaxed)) return false;
+            std::unique_lock<std::mutex> lck(m_depot_lock, std::try_to_lock);
+            auto size = m_depot_size.load(std::memory_order_relaxed);
+            if(!lck.owns_lock() || !size) return false;
+            magazine = m_depot[size - 1];
+            m_depot_size.store(size - 1, std::memory_order_relaxed);
+            return true;
+        }
+        // the magazine is left empty on success
+        bool put_full(magazine_type& magazine)
+        {
+            if(m_depot_size.load(std::memory_order_relaxed) == DEPOT_SIZE)
+                return false;
+            std::unique_lock<std::mutex> lck(m_depot_lock, std::try_to_lock);
+            auto size = m_depot_size.load(std::memory_order_relaxed);
+            if(!lck.owns_lock() || size == DEPOT_SIZE) return false;
+            m_depot[size] = magazine;
+            m_depot_size.store(size + 1, std::memory_order_relaxed);
+            magazine.size = 0;
+            return true;
+        }
+
+    private:
+        bool m_enabled = true;
+        std::array<perthread_data_type, MAX_THREADS_NUMBER> m_thread_data;
+        std::mutex m_depot_lock;
+        std::atomic<uint64_t> m_depot_size{0};
+        std::array<magazine_type, DEPOT_SIZE> m_depot;
+    };
+
+
+    constexpr uint64_t round_up_pow2(uint64_t val)
+    {
+        uint64_t ret = 1;
+        while(ret < val) ret <<= 1;
+        return ret;
+    }
+
+
+    template <typename Allocator>
+    class allocator_holder
+    {
+    public:
+        using allocator_type = Allocator;
+        using node_type = typename Allocator::value_type;
+        using value_type = typename node_type::value_type;
+
+    public:
+        node_type* allocate_and_construct()
+        {
+            auto ptr = m_allocator.allocate(1);
+            m_allocator.construct(ptr);
+            return ptr;
+        }
+        node_type* allocate_and_construct(value_type const& val)
         {
             auto ptr = m_allocator.allocate(1);
             // it's beter to use type_traits for check noexcept constructors
@@ -455,37 +1272,1366 @@ namespace lock_free
                 m_allocator.deallocate(ptr, 1);
                 throw;
             }
-            return ptr;
+            return ptr;
+        }
+        void destroy_and_deallocate(node_type* ptr)
+        {
+            m_allocator.destroy(ptr);
+            m_allocator.deallocate(ptr, 1);
+        }
+        // one contiguous allocation for number nodes
+        node_type* allocate_and_construct_slab(uint64_t number)
+        {
+            auto ptr = m_allocator.allocate(number);
+            for(uint64_t i = 0; i < number; ++i)
+                m_allocator.construct(ptr + i);
+            return ptr;
+        }
+        void destroy_and_deallocate_slab(node_type* ptr, uint64_t number)
+        {
+            for(uint64_t i = 0; i < number; ++i)
+                m_allocator.destroy(ptr + i);
+            m_allocator.deallocate(ptr, number);
+        }
+        // for recycled nodes
+        void reconstruct(node_type* ptr)
+        {
+            m_allocator.destroy(ptr);
+            m_allocator.construct(ptr);
+        }
+
+        allocator_type& get_allocator()
+        {
+            return m_allocator;
+        }
+
+    private:
+        allocator_type m_allocator;
+    };
+
+    // hazard pointer publication: light() follows every set_hp,
+    // heavy() precedes every scan of hazard pointers; the two fences
+    // order the published pointer before the validating re-read
+    // (StoreLoad), so a scan sees it or the reader sees the unlink
+    struct symmetric_hp_fence
+    {
+        static constexpr std::memory_order HP_STORE_ORDER =
+            std::memory_order_release;
+
+        void light() const
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+        void heavy() const
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+    };
+
+#ifdef __linux__
+    // readers pay a compiler barrier only, the reclaimer forces
+    // a full fence on all the threads of the process by membarrier
+    struct membarrier_hp_fence
+    {
+        static constexpr std::memory_order HP_STORE_ORDER =
+            std::memory_order_relaxed;
+
+        membarrier_hp_fence()
+        {
+            static const bool registered = register_process();
+            if(!registered)
+            {
+                throw std::runtime_error("private expedited membarrier is absent");
+            }
+        }
+
+        void light() const
+        {
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+        }
+        void heavy() const
+        {
+            syscall(__NR_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0);
+        }
+
+    private:
+        static bool register_process()
+        {
+            auto cmds = syscall(__NR_membarrier, MEMBARRIER_CMD_QUERY, 0);
+            if(cmds < 0 || !(cmds & MEMBARRIER_CMD_PRIVATE_EXPEDITED))
+            {
+                return false;
+            }
+            return !syscall(
+                __NR_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0
+            );
+        }
+    };
+#endif
+
+    // tp containers can't free a node without a trimming policy,
+    // a reader may hold a stale pointer to any node until its
+    // operation ends
+    struct no_trimming
+    {
+        static constexpr bool ENABLED = false;
+        static constexpr uint64_t WATERMARK = 0;
+
+        template <uint64_t MaxThreadsNumber, uint64_t BucketsNumber>
+        struct rebind
+        {
+            using other = no_trimming;
+        };
+
+        void enter(uint64_t /*thread_index*/) {}
+        void leave(uint64_t /*thread_index*/) {}
+        bool need_trim(uint64_t /*thread_index*/) { return false; }
+        template <typename Detach, typename Free>
+        uint64_t trim(uint64_t, Detach&&, Free&&, bool /*wait*/)
+        {
+            return 0;
+        }
+    };
+
+    template <typename Trimming>
+    class trimming_guard: boost::noncopyable
+    {
+    public:
+        trimming_guard(Trimming& trimming, uint64_t thread_index):
+            m_trimming(trimming), m_thread_index(thread_index)
+        {
+            m_trimming.enter(m_thread_index);
+        }
+        ~trimming_guard()
+        {
+            m_trimming.leave(m_thread_index);
+        }
+
+    private:
+        Trimming& m_trimming;
+        uint64_t m_thread_index;
+    };
+
+#ifdef __linux__
+    // the operations are counted per thread, a detached node is freed
+    // once every other thread which was inside an operation has left it;
+    // with Period > 0 a thread trims the pool down to Watermark nodes
+    // per bucket after every Period freed nodes, detaching only the
+    // surplus, and skips the trim if another thread is trimming.
+    // A container rebinds it to its own MaxThreadsNumber
+    template <
+        uint64_t MaxThreadsNumber = 1,
+        uint64_t Period = 0,
+        uint64_t Watermark = 0
+    > class quiescent_trimming: boost::noncopyable
+    {
+    public:
+        static constexpr bool ENABLED = true;
+        static constexpr uint64_t MAX_THREADS_NUMBER = MaxThreadsNumber;
+        static constexpr uint64_t PERIOD = Period;
+        static constexpr uint64_t WATERMARK = Watermark;
+
+        template <uint64_t ThreadsNumber, uint64_t /*BucketsNumber*/>
+        struct rebind
+        {
+            using other = quiescent_trimming<ThreadsNumber, Period, Watermark>;
+        };
+
+        struct perthread_data_type
+        {
+            std::atomic<uint64_t> operations{0}; // odd inside an operation
+            uint64_t depth = 0;
+            uint64_t freed_number = 0;
+            char padding[128 - 3 * sizeof(uint64_t)];
+        };
+        struct batch_type
+        {
+            std::vector<void*> nodes;
+            std::array<uint64_t, MAX_THREADS_NUMBER> operations;
+        };
+
+    public:
+        // the operations may nest, only the outer one is counted
+        void enter(uint64_t thread_index)
+        {
+            auto& data = m_thread_data[thread_index];
+            if(data.depth++) return;
+            data.operations.store(
+                data.operations.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed
+            );
+            m_fence.light();
+        }
+        void leave(uint64_t thread_index)
+        {
+            auto& data = m_thread_data[thread_index];
+            if(--data.depth) return;
+            data.operations.store(
+                data.operations.load(std::memory_order_relaxed) + 1,
+                std::memory_order_release
+            );
+        }
+        bool need_trim(uint64_t thread_index)
+        {
+            return PERIOD &&
+                !(++m_thread_data[thread_index].freed_number % PERIOD);
+        }
+        // detach fills the vector with the nodes unlinked from the pool,
+        // they wait for the readers and go to free at this or a later
+        // call; returns the number of the freed nodes
+        template <typename Detach, typename Free>
+        uint64_t trim(
+            uint64_t thread_index, Detach&& detach, Free&& free, bool wait
+        ) {
+            std::unique_lock<std::mutex> lck(m_lock, std::defer_lock);
+            if(wait) lck.lock();
+            else if(!lck.try_lock()) return 0;
+
+            batch_type batch;
+            detach(batch.nodes);
+            if(!batch.nodes.empty())
+            {
+                m_fence.heavy();
+                for(uint64_t i = 0; i < MAX_THREADS_NUMBER; ++i)
+                {
+                    batch.operations[i] = m_thread_data[i].operations.load(
+                        std::memory_order_acquire
+                    );
+                }
+                // the caller doesn't keep pointers to what it has detached
+                batch.operations[thread_index] = 0;
+                m_batches.push_back(std::move(batch));
+            }
+
+            uint64_t number = 0;
+            auto it = std::remove_if(
+                m_batches.begin(),
+                m_batches.end(),
+                [this, &free, &number] (batch_type& ref) {
+                    if(!is_quiescent(ref)) return false;
+                    for(auto ptr : ref.nodes) free(ptr);
+                    number += ref.nodes.size();
+                    return true;
+                }
+            );
+            m_batches.erase(it, m_batches.end());
+            lck.unlock();
+#ifdef __GLIBC__
+            // glibc keeps the freed small chunks otherwise; only on the
+            // explicit trim, the periodic one runs inside an operation
+            if(number && wait) malloc_trim(0);
+#endif
+            return number;
+        }
+
+    private:
+        bool is_quiescent(batch_type const& batch) const
+        {
+            for(uint64_t i = 0; i < MAX_THREADS_NUMBER; ++i)
+            {
+                auto operations = batch.operations[i];
+                if((operations & 1) &&
+                   operations == m_thread_data[i].operations.load(
+                       std::memory_order_acquire
+                   )
+                ) return false;
+            }
+            return true;
+        }
+
+    private:
+        std::array<perthread_data_type, MAX_THREADS_NUMBER> m_thread_data;
+        membarrier_hp_fence m_fence;
+        std::mutex m_lock;
+        std::vector<batch_type> m_batches;
+    };
+#endif
+
+    template <uint64_t BucketsNumber>
+    struct pool_statistics_snapshot
+    {
+        std::array<uint64_t, BucketsNumber> free_nodes{}; // in the holders
+        uint64_t magazine_hits = 0;
+        uint64_t bucket_hits = 0;
+        uint64_t steals = 0; // taken from the other buckets
+        uint64_t allocations = 0; // the pool was empty
+        uint64_t rejections = 0; // max_nodes_number was reached
+        uint64_t trimmed = 0;
+        uint64_t get_retries = 0; // failed CAS in the holders
+        uint64_t save_retries = 0;
+    };
+
+    // the counter ids shared by the statistics policies
+    struct pool_counters
+    {
+        static constexpr uint64_t MAGAZINE_HITS = 0;
+        static constexpr uint64_t BUCKET_HITS = 1;
+        static constexpr uint64_t STEALS = 2;
+        static constexpr uint64_t ALLOCATIONS = 3;
+        static constexpr uint64_t REJECTIONS = 4;
+        static constexpr uint64_t TRIMMED = 5;
+        static constexpr uint64_t GET_RETRIES = 6;
+        static constexpr uint64_t SAVE_RETRIES = 7;
+        static constexpr uint64_t COUNTERS_NUMBER = 8;
+    };
+
+    // tp containers count their pool traffic only with a statistics
+    // policy, the calls below are empty otherwise
+    struct no_pool_statistics: pool_counters
+    {
+        static constexpr bool ENABLED = false;
+
+        using snapshot_type = pool_statistics_snapshot<0>;
+
+        template <uint64_t MaxThreadsNumber, uint64_t BucketsNumber>
+        struct rebind
+        {
+            using other = no_pool_statistics;
+        };
+
+        void add(uint64_t, uint64_t /*counter*/, uint64_t /*number*/ = 1) {}
+        void add_free(uint64_t, uint64_t /*bucket_index*/, int64_t) {}
+        uint64_t get_free_nodes(uint64_t /*bucket_index*/) const
+        {
+            return 0;
+        }
+    };
+
+    // the counters are sharded per thread, each shard has one writer
+    // and is summed up only by snapshot; the free nodes of a bucket are
+    // the sum of the deltas of all threads. The shards are indexed by
+    // the container, which rebinds it to its own sizes
+    template <uint64_t MaxThreadsNumber = 1, uint64_t BucketsNumber = 1>
+    class pool_statistics: public pool_counters, boost::noncopyable
+    {
+    public:
+        static constexpr bool ENABLED = true;
+        static constexpr uint64_t MAX_THREADS_NUMBER = MaxThreadsNumber;
+        static constexpr uint64_t BUCKETS_NUMBER = BucketsNumber;
+
+        using snapshot_type = pool_statistics_snapshot<BUCKETS_NUMBER>;
+
+        template <uint64_t ThreadsNumber, uint64_t OtherBucketsNumber>
+        struct rebind
+        {
+            using other = pool_statistics<ThreadsNumber, OtherBucketsNumber>;
+        };
+
+        struct perthread_data_type
+        {
+            std::array<std::atomic<uint64_t>, COUNTERS_NUMBER> counters{};
+            std::array<std::atomic<uint64_t>, BUCKETS_NUMBER> free_nodes{};
+            char padding[
+                128 - (COUNTERS_NUMBER + BUCKETS_NUMBER) * 8 % 128
+            ];
+        };
+
+    public:
+        void add(uint64_t thread_index, uint64_t counter, uint64_t number = 1)
+        {
+            if(!number) return;
+            increment(m_thread_data[thread_index].counters[counter], number);
+        }
+        // the deltas wrap around, only the sum is meaningful
+        void add_free(
+            uint64_t thread_index,
+            uint64_t bucket_index,
+            int64_t delta
+        )
+        {
+            increment(
+                m_thread_data[thread_index].free_nodes[bucket_index],
+                static_cast<uint64_t>(delta)
+            );
+        }
+
+        snapshot_type snapshot() const
+        {
+            std::array<uint64_t, COUNTERS_NUMBER> counters{};
+            snapshot_type ret;
+            for(auto& data : m_thread_data)
+            {
+                for(uint64_t i = 0; i < COUNTERS_NUMBER; ++i)
+                {
+                    counters[i] +=
+                        data.counters[i].load(std::memory_order_relaxed);
+                }
+                for(uint64_t i = 0; i < BUCKETS_NUMBER; ++i)
+                {
+                    ret.free_nodes[i] +=
+                        data.free_nodes[i].load(std::memory_order_relaxed);
+                }
+            }
+            ret.magazine_hits = counters[MAGAZINE_HITS];
+            ret.bucket_hits = counters[BUCKET_HITS];
+            ret.steals = counters[STEALS];
+            ret.allocations = counters[ALLOCATIONS];
+            ret.rejections = counters[REJECTIONS];
+            ret.trimmed = counters[TRIMMED];
+            ret.get_retries = counters[GET_RETRIES];
+            ret.save_retries = counters[SAVE_RETRIES];
+            return ret;
+        }
+        // may lag behind the concurrent operations
+        uint64_t get_free_nodes(uint64_t bucket_index) const
+        {
+            uint64_t ret = 0;
+            for(auto& data : m_thread_data)
+            {
+                ret += data.free_nodes[bucket_index].load(
+                    std::memory_order_relaxed
+                );
+            }
+            return ret;
+        }
+
+    private:
+        // no RMW, the shard has a single writer
+        static void increment(std::atomic<uint64_t>& counter, uint64_t number)
+        {
+            counter.store(
+                counter.load(std::memory_order_relaxed) + number,
+                std::memory_order_relaxed
+            );
+        }
+
+    private:
+        std::array<perthread_data_type, MAX_THREADS_NUMBER> m_thread_data;
+    };
+
+    // the containers without a waiting policy only spin
+    struct no_waiting
+    {
+        static constexpr bool ENABLED = false;
+
+        void notify(uint64_t /*number*/ = 1) {}
+        template <typename Predicate>
+        bool wait_for(std::chrono::nanoseconds, Predicate&&) { return false; }
+    };
+
+#ifdef __linux__
+    // eventcount over a futex: a waiter registers, re-checks the
+    // container and parks until the epoch moves; while nobody waits the
+    // notifier pays a compiler barrier and a relaxed load, the waiter
+    // pairs it with membarrier before the re-check
+    class futex_waiting: boost::noncopyable
+    {
+    public:
+        static constexpr bool ENABLED = true;
+        static constexpr uint64_t SPINS_NUMBER = 128;
+
+        using duration_type = std::chrono::nanoseconds;
+
+        // the key to wait for, cancel_wait or wait must follow
+        uint32_t prepare_wait()
+        {
+            m_waiters.fetch_add(1, std::memory_order_relaxed);
+            m_fence.heavy();
+            return m_epoch.load(std::memory_order_acquire);
+        }
+        void cancel_wait()
+        {
+            m_waiters.fetch_sub(1, std::memory_order_relaxed);
+        }
+        // false if the timeout expired, wakeups may be spurious
+        bool wait(uint32_t key, duration_type timeout)
+        {
+            timespec ts;
+            timespec* ts_ptr = nullptr;
+            if(timeout != duration_type::max())
+            {
+                auto sec = std::chrono::duration_cast<std::chrono::seconds>(
+                    timeout
+                );
+                ts.tv_sec = sec.count();
+                ts.tv_nsec = (timeout - sec).count();
+                ts_ptr = &ts;
+            }
+            auto ret = syscall(
+                SYS_futex,
+                reinterpret_cast<uint32_t*>(&m_epoch),
+                FUTEX_WAIT_PRIVATE,
+                key,
+                ts_ptr,
+                nullptr,
+                0
+            );
+            bool timed_out = ret && errno == ETIMEDOUT;
+            cancel_wait();
+            return !timed_out;
+        }
+        // spins on pred first, then parks between the attempts
+        template <typename Predicate>
+        bool wait_for(duration_type timeout, Predicate&& pred)
+        {
+            using clock_type = std::chrono::steady_clock;
+
+            for(uint64_t i = 0; i < SPINS_NUMBER; ++i)
+            {
+                if(pred()) return true;
+            }
+            bool infinite = timeout == duration_type::max();
+            auto deadline = clock_type::now();
+            if(!infinite) deadline += timeout;
+            while(true)
+            {
+                auto key = prepare_wait();
+                if(pred())
+                {
+                    cancel_wait();
+                    return true;
+                }
+                auto remaining = duration_type::max();
+                if(!infinite)
+                {
+                    remaining = std::chrono::duration_cast<duration_type>(
+                        deadline - clock_type::now()
+                    );
+                    if(remaining.count() <= 0)
+                    {
+                        cancel_wait();
+                        return false;
+                    }
+                }
+                wait(key, remaining);
+            }
+        }
+        // wakes up to number waiters, after the change they wait for
+        void notify(uint64_t number = 1)
+        {
+            m_fence.light();
+            if(!m_waiters.load(std::memory_order_relaxed)) return;
+            m_epoch.fetch_add(1, std::memory_order_release);
+            syscall(
+                SYS_futex,
+                reinterpret_cast<uint32_t*>(&m_epoch),
+                FUTEX_WAKE_PRIVATE,
+                static_cast<int>(std::min<uint64_t>(number, INT_MAX)),
+                nullptr,
+                nullptr,
+                0
+            );
+        }
+
+    private:
+        std::atomic<uint32_t> m_epoch{0};
+        char padding1[128 - sizeof m_epoch];
+        std::atomic<uint64_t> m_waiters{0};
+        char padding2[128 - sizeof m_waiters];
+        membarrier_hp_fence m_fence;
+    };
+#endif
+
+    // the thread whose free_ptrs is full scans hazard pointers inline
+    struct inline_reclamation
+    {
+        static constexpr bool BACKGROUND = false;
+        static constexpr uint64_t MAX_PENDING_NODES = 0;
+    };
+    // full free_ptrs are copied to a preallocated per thread batch and
+    // handed off to a reclaimer thread; a worker scans inline while its
+    // previous batch is not taken yet or MaxPendingNodes retired nodes
+    // wait for the reclaimer
+    template <uint64_t MaxPendingNodes = 1024 * 1024>
+    struct background_reclamation
+    {
+        static constexpr bool BACKGROUND = true;
+        static constexpr uint64_t MAX_PENDING_NODES = MaxPendingNodes;
+    };
+
+
+    // per thread list of the slots taken in thread_registry objects,
+    // the slots are released at thread exit
+    struct thread_slots_control
+    {
+        std::mutex lock;
+        std::function<void(uint64_t)> release; // empty if registry is dead
+        std::atomic<bool> dead{false}; // read without the lock
+    };
+
+    struct thread_slots: boost::noncopyable
+    {
+        struct entry_type
+        {
+            uint64_t registry_id;
+            uint64_t slot;
+            std::shared_ptr<thread_slots_control> control;
+        };
+
+        ~thread_slots()
+        {
+            for(auto& ref : entries)
+            {
+                std::lock_guard<std::mutex> lck(ref.control->lock);
+                if(ref.control->release) ref.control->release(ref.slot);
+            }
+        }
+
+        std::vector<entry_type> entries;
+    };
+
+    // trivial type, so thread_local access doesn't need init guard;
+    // set associative by the registry id, round robin within a set.
+    // The ids start from 1 and are never reused, so an empty entry or
+    // an entry of a dead registry never matches
+    struct thread_slot_cache
+    {
+        static constexpr uint64_t SETS = 4;
+        static constexpr uint64_t WAYS = 4;
+
+        struct entry_type
+        {
+            uint64_t registry_id;
+            uint64_t slot;
+        };
+        struct set_type
+        {
+            entry_type entries[WAYS];
+            uint64_t victim;
+        };
+
+        bool find(uint64_t registry_id, uint64_t& slot) const
+        {
+            auto& set = sets[registry_id % SETS];
+            for(auto& ref : set.entries)
+            {
+                if(ref.registry_id != registry_id) continue;
+                slot = ref.slot;
+                return true;
+            }
+            return false;
+        }
+        void insert(uint64_t registry_id, uint64_t slot)
+        {
+            auto& set = sets[registry_id % SETS];
+            set.entries[set.victim++ % WAYS] = {registry_id, slot};
+        }
+
+        set_type sets[SETS];
+    };
+
+    inline thread_slots& get_thread_slots()
+    {
+        thread_local thread_slots slots;
+        return slots;
+    }
+    inline thread_slot_cache& get_thread_slot_cache()
+    {
+        thread_local thread_slot_cache cache;
+        return cache;
+    }
+    inline uint64_t make_registry_id()
+    {
+        static std::atomic<uint64_t> id(0);
+        return id.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    template <uint64_t MaxThreadsNumber>
+    class thread_registry: boost::noncopyable
+    {
+    public:
+        static constexpr uint64_t MAX_THREADS_NUMBER = MaxThreadsNumber;
+
+        using callback_type = std::function<void(uint64_t)>;
+
+    public:
+        // on_acquire is called by the thread that takes a slot,
+        // on_release by the exiting thread that owned the slot
+        thread_registry(
+            callback_type on_acquire = callback_type(),
+            callback_type on_release = callback_type()
+        ):
+            m_id(make_registry_id()),
+            m_threads_number(0),
+            m_on_acquire(std::move(on_acquire)),
+            m_control(std::make_shared<thread_slots_control>())
+        {
+            for(auto& ref : m_busy) ref.store(false, std::memory_order_relaxed);
+            m_control->release =
+                [this, on_release = std::move(on_release)] (uint64_t slot)
+                {
+                    if(on_release) on_release(slot);
+                    m_busy[slot].store(false, std::memory_order_release);
+                };
+        }
+        ~thread_registry()
+        {
+            std::lock_guard<std::mutex> lck(m_control->lock);
+            m_control->release = nullptr;
+            m_control->dead.store(true, std::memory_order_release);
+        }
+
+        uint64_t get_thread_index()
+        {
+            uint64_t slot = 0;
+            if(get_thread_slot_cache().find(m_id, slot)) return slot;
+            return acquire_thread_index();
+        }
+        // high water mark of the slots, for scans over the thread data
+        uint64_t get_threads_number() const
+        {
+            return m_threads_number.load(std::memory_order_acquire);
+        }
+
+    private:
+        uint64_t acquire_thread_index()
+        {
+            auto& cache = get_thread_slot_cache();
+            auto& entries = get_thread_slots().entries;
+            // a cache miss of a slot taken before, no locks
+            for(auto& ref : entries)
+            {
+                if(ref.registry_id != m_id) continue;
+                cache.insert(m_id, ref.slot);
+                return ref.slot;
+            }
+            // a new slot, the entries of dead registries are dropped,
+            // so the list is bounded by the live registries
+            entries.erase(
+                std::remove_if(entries.begin(), entries.end(), is_dead),
+                entries.end()
+            );
+
+            for(uint64_t i = 0; i < MAX_THREADS_NUMBER; ++i)
+            {
+                bool busy = false;
+                if(m_busy[i].load(std::memory_order_relaxed) ||
+                   !m_busy[i].compare_exchange_strong(
+                       busy, true, std::memory_order_acq_rel
+                   )
+                ) continue;
+
+                auto number = m_threads_number.load(std::memory_order_relaxed);
+                while(number < i + 1 && !m_threads_number.compare_exchange_weak(
+                    number, i + 1, std::memory_order_seq_cst
+                ));
+                entries.push_back({m_id, i, m_control});
+                cache.insert(m_id, i);
+                if(m_on_acquire) m_on_acquire(i);
+                return i;
+            }
+            throw std::runtime_error("Too many threads");
+        }
+        static bool is_dead(const thread_slots::entry_type& entry)
+        {
+            return entry.control->dead.load(std::memory_order_acquire);
+        }
+
+    private:
+        const uint64_t m_id;
+        std::atomic<uint64_t> m_threads_number;
+        std::array<std::atomic<bool>, MAX_THREADS_NUMBER> m_busy;
+        callback_type m_on_acquire;
+        std::shared_ptr<thread_slots_control> m_control;
+    };
+
+    // retired nodes of exited threads, adopted by the next scans
+    template <typename Entry>
+    class orphans_holder: boost::noncopyable
+    {
+    public:
+        using entry_type = Entry;
+
+        struct batch_type
+        {
+            std::vector<entry_type> entries;
+            batch_type* next = nullptr;
+        };
+
+    public:
+        orphans_holder(): m_head(nullptr) {}
+        ~orphans_holder()
+        {
+            assert(m_head.load(std::memory_order_relaxed) == nullptr);
+        }
+
+        void push(std::vector<entry_type>&& entries)
+        {
+            if(entries.empty()) return;
+            auto batch = new batch_type{std::move(entries), nullptr};
+            auto head = m_head.load(std::memory_order_relaxed);
+            do {
+                batch->next = head;
+            } while(!m_head.compare_exchange_weak(
+                head, batch, std::memory_order_release
+            ));
+        }
+        // batches are taken all at once, so there is no ABA
+        std::vector<entry_type> take()
+        {
+            std::vector<entry_type> ret;
+            if(!m_head.load(std::memory_order_relaxed)) return ret;
+            auto batch = m_head.exchange(nullptr, std::memory_order_acquire);
+            while(batch)
+            {
+                ret.insert(ret.end(), batch->entries.begin(), batch->entries.end());
+                auto next = batch->next;
+                delete batch;
+                batch = next;
+            }
+            return ret;
+        }
+
+    private:
+        std::atomic<batch_type*> m_head;
+    };
+
+	
+    template<
+        uint64_t MaxThreadsNumber,
+        typename T,
+        typename Allocator,
+        typename BackOff = wait_backoff,
+        typename Fence = symmetric_hp_fence,
+        typename Reclamation = inline_reclamation
+    > class hp_manager: boost::noncopyable
+    {
+    public:
+        static constexpr uint64_t MAX_THREADS_NUMBER = MaxThreadsNumber;
+        static constexpr uint64_t K = 2;
+        static constexpr uint64_t HP_NUM = 8;
+        static constexpr uint64_t FREE_PTR_NUM = K * HP_NUM * MAX_THREADS_NUMBER;
+        static constexpr uint64_t CURRENT_THREAD_ID = -1;
+        // containers must re-read the source after set_hp
+        static constexpr bool NEED_HP_VALIDATION = true;
+        // reclaimed nodes are kept for get_node instead of deallocation
+        static constexpr uint64_t CACHED_NODES_NUM = FREE_PTR_NUM;
+        static constexpr uint64_t SHARED_NODES_NUM =
+            CACHED_NODES_NUM * MAX_THREADS_NUMBER;
+        static constexpr uint64_t HPS_TABLE_SIZE =
+            round_up_pow2(2 * HP_NUM * MAX_THREADS_NUMBER);
+        // the reclaimer thread caches nodes in the extra thread data entry
+        static constexpr uint64_t RECLAIMER_INDEX = MAX_THREADS_NUMBER;
+        static constexpr uint64_t RECLAIMER_PERIOD_MSEC = 1;
+
+        using node_type = T;
+        using value_type = typename T::value_type;
+        using allocator_type =
+            typename Allocator::template rebind<node_type>::other;
+        using allocator_holder_type = allocator_holder<allocator_type>;
+        using backoff_strategy_type = BackOff;
+        using fence_type = Fence;
+        using reclamation_type = Reclamation;
+
+        struct thread_data_entry_type
+        {
+            std::array<std::atomic<node_type*>, HP_NUM> thread_hps = {};
+            uint64_t free_ptrs_index = 0;
+            std::array<node_type*, FREE_PTR_NUM> free_ptrs = {};
+            uint64_t cached_nodes_index = 0;
+            std::array<node_type*, CACHED_NODES_NUM> cached_nodes = {};
+            // the batch belongs to the reclaimer while the number isn't 0
+            std::atomic<uint64_t> handed_off_number{0};
+            std::array<
+                node_type*, reclamation_type::BACKGROUND ? FREE_PTR_NUM : 0
+            > handed_off_ptrs = {};
+        };
+
+        struct hps_table_type
+        {
+            std::array<node_type*, HPS_TABLE_SIZE> data;
+            uint64_t mask = 0;
+            uint64_t total = 0;
+        };
+
+    public:
+        hp_manager():
+            m_threads_number(0),
+            m_scan_threshold(K * HP_NUM),
+            m_shared_nodes(nullptr),
+            m_shared_nodes_number(0),
+            m_pending_nodes(0),
+            m_reclaimer_stop(false),
+            m_reclaimer_parked(false)
+        {
+            if(reclamation_type::BACKGROUND)
+            {
+                m_reclaimer = std::thread([this] () { reclaimer_loop(); });
+            }
+        }
+        ~hp_manager()
+        {
+            if(m_reclaimer.joinable())
+            {
+                {
+                    std::lock_guard<std::mutex> lck(m_reclaimer_lock);
+                    m_reclaimer_stop.store(true, std::memory_order_relaxed);
+                }
+                m_reclaimer_cv.notify_one();
+                m_reclaimer.join();
+            }
+            for(auto ptr : m_reclaimer_busy)
+            {
+                m_allocator_holder.destroy_and_deallocate(ptr);
+            }
+            for(auto ptr : m_orphans.take())
+            {
+                m_allocator_holder.destroy_and_deallocate(ptr);
+            }
+            for(auto& thread_data : m_threads_data)
+            {
+                auto& free_ptrs = thread_data.free_ptrs;
+                for(uint64_t j = 0; j < thread_data.free_ptrs_index; ++j)
+                {
+                    m_allocator_holder.destroy_and_deallocate(free_ptrs[j]);
+                }
+                auto& cached_nodes = thread_data.cached_nodes;
+                for(uint64_t j = 0; j < thread_data.cached_nodes_index; ++j)
+                {
+                    m_allocator_holder.destroy_and_deallocate(cached_nodes[j]);
+                }
+                auto number = thread_data.handed_off_number.load(
+                    std::memory_order_relaxed
+                );
+                for(uint64_t j = 0; j < number; ++j)
+                {
+                    m_allocator_holder.destroy_and_deallocate(
+                        thread_data.handed_off_ptrs[j]
+                    );
+                }
+            }
+            auto ptr = m_shared_nodes.load(std::memory_order_relaxed);
+            while(ptr)
+            {
+                auto next = ptr->next.load(std::memory_order_relaxed);
+                m_allocator_holder.destroy_and_deallocate(ptr);
+                ptr = next;
+            }
+        }
+
+        void thread_init(uint64_t thread_index)
+        {
+            update_threads_number(thread_index + 1);
+        }
+        // the thread with thread_index has exited, its slot may be reused
+        void thread_release(uint64_t thread_index)
+        {
+            auto& thread_data = m_threads_data[thread_index];
+            for(auto& ref : thread_data.thread_hps)
+            {
+                ref.store(nullptr, std::memory_order_release);
+            }
+            m_orphans.push(std::vector<node_type*>(
+                thread_data.free_ptrs.data(),
+                thread_data.free_ptrs.data() + thread_data.free_ptrs_index
+            ));
+            thread_data.free_ptrs_index = 0;
+        }
+        void init(
+            uint64_t threads_number,
+            uint64_t /*init_nodes_number*/,
+            uint64_t /*max_nodes_number*/
+        ) {
+            update_threads_number(threads_number);
+        }
+
+        void set_hp(uint64_t thread_index, uint64_t pos, node_type* ptr)
+        {
+            auto& thread_data_entry = m_threads_data[thread_index];
+            thread_data_entry.thread_hps[pos].store(
+                ptr, fence_type::HP_STORE_ORDER
+            );
+            m_fence.light();
+        }
+        node_type* get_hp(uint64_t thread_index, uint64_t pos)
+        {
+            auto& thread_data_entry = m_threads_data[thread_index];
+            return thread_data_entry.thread_hps[pos].load(
+                std::memory_order_acquire
+            );
+        }
+
+        void remove_node(uint64_t thread_index, node_type* ptr)
+        {
+            auto& thread_data_entry = m_threads_data[thread_index];
+            thread_data_entry.free_ptrs[thread_data_entry.free_ptrs_index++] = ptr;
+            if(thread_data_entry.free_ptrs_index >=
+               m_scan_threshold.load(std::memory_order_relaxed)
+            ) {
+                if(reclamation_type::BACKGROUND && hand_off(thread_index)) return;
+                erase(thread_index);
+            }
+        }
+        // if ptr wasn't in the chain (it is yet unused)
+        void physically_remove_node(node_type* ptr)
+        {
+            if(m_shared_nodes_number.load(std::memory_order_relaxed) >=
+               SHARED_NODES_NUM
+            ) {
+                m_allocator_holder.destroy_and_deallocate(ptr);
+                return;
+            }
+            push_shared_nodes(ptr, ptr, 1);
+        }
+
+        node_type* get_node(uint64_t thread_index)
+        {
+            auto& thread_data = m_threads_data[thread_index];
+            if(!thread_data.cached_nodes_index) refill_cached_nodes(thread_index);
+            if(!thread_data.cached_nodes_index)
+            {
+                return m_allocator_holder.allocate_and_construct();
+            }
+            auto ptr =
+                thread_data.cached_nodes[--thread_data.cached_nodes_index];
+            m_allocator_holder.reconstruct(ptr);
+            return ptr;
+        }
+        node_type* get_node(uint64_t thread_index, const value_type& val)
+        {
+            auto ptr = get_node(thread_index);
+            ptr->value = val;
+            return ptr;
+        }
+
+    private:
+        void update_threads_number(uint64_t threads_number)
+        {
+            auto number = m_threads_number.load(std::memory_order_relaxed);
+            while(number < threads_number &&
+                  !m_threads_number.compare_exchange_weak(
+                      number, threads_number, std::memory_order_seq_cst
+                  )
+            );
+            // at most HP_NUM * m_threads_number nodes survive a scan
+            number = m_threads_number.load(std::memory_order_relaxed);
+            m_scan_threshold.store(
+                std::min(K * HP_NUM * std::max<uint64_t>(number, 1), FREE_PTR_NUM),
+                std::memory_order_relaxed
+            );
+        }
+
+        void cache_node(uint64_t thread_index, node_type* ptr)
+        {
+            auto& thread_data = m_threads_data[thread_index];
+            if(thread_data.cached_nodes_index == CACHED_NODES_NUM)
+            {
+                spill_cached_nodes(thread_index, CACHED_NODES_NUM / 2);
+            }
+            thread_data.cached_nodes[thread_data.cached_nodes_index++] = ptr;
+        }
+        // the oldest number nodes of the cache go to the shared pool
+        void spill_cached_nodes(uint64_t thread_index, uint64_t number)
+        {
+            auto& thread_data = m_threads_data[thread_index];
+            auto& cached_nodes = thread_data.cached_nodes;
+            if(!number) return;
+
+            if(m_shared_nodes_number.load(std::memory_order_relaxed) >=
+               SHARED_NODES_NUM
+            ) {
+                for(uint64_t i = 0; i < number; ++i)
+                {
+                    m_allocator_holder.destroy_and_deallocate(cached_nodes[i]);
+                }
+            }
+            else {
+                for(uint64_t i = 0; i + 1 < number; ++i)
+                {
+                    cached_nodes[i]->next.store(
+                        cached_nodes[i + 1], std::memory_order_relaxed
+                    );
+                }
+                push_shared_nodes(
+                    cached_nodes[0], cached_nodes[number - 1], number
+                );
+            }
+            std::copy(
+                cached_nodes.data() + number,
+                cached_nodes.data() + thread_data.cached_nodes_index,
+                cached_nodes.data()
+            );
+            thread_data.cached_nodes_index -= number;
+        }
+        // the whole pool is taken by exchange, so ABA is impossible
+        void refill_cached_nodes(uint64_t thread_index)
+        {
+            auto& thread_data = m_threads_data[thread_index];
+            auto ptr = m_shared_nodes.exchange(
+                nullptr, std::memory_order_acquire
+            );
+            if(!ptr) return;
+
+            uint64_t number = 0;
+            while(ptr && thread_data.cached_nodes_index < CACHED_NODES_NUM)
+            {
+                thread_data.cached_nodes[thread_data.cached_nodes_index++] = ptr;
+                ptr = ptr->next.load(std::memory_order_relaxed);
+                ++number;
+            }
+            m_shared_nodes_number.fetch_sub(number, std::memory_order_relaxed);
+            if(!ptr) return;
+
+            auto last = ptr;
+            uint64_t rest = 1;
+            while(auto next = last->next.load(std::memory_order_relaxed))
+            {
+                last = next;
+                ++rest;
+            }
+            m_shared_nodes_number.fetch_sub(rest, std::memory_order_relaxed);
+            push_shared_nodes(ptr, last, rest);
+        }
+        void push_shared_nodes(node_type* first, node_type* last, uint64_t number)
+        {
+            m_shared_nodes_number.fetch_add(number, std::memory_order_relaxed);
+            auto head = m_shared_nodes.load(std::memory_order_relaxed);
+            while(true)
+            {
+                last->next.store(head, std::memory_order_relaxed);
+                if(m_shared_nodes.compare_exchange_weak(
+                    head, first, std::memory_order_release
+                )) break;
+            }
+        }
+
+        static uint64_t hash_pointer(node_type* ptr)
+        {
+            return (reinterpret_cast<uint64_t>(ptr) * 0x9E3779B97F4A7C15) >> 32;
+        }
+        // open addressing, mask + 1 is at least twice the number of hps
+        static void insert_hp(node_type** table, uint64_t mask, node_type* ptr)
+        {
+            auto i = hash_pointer(ptr) & mask;
+            while(table[i])
+            {
+                if(table[i] == ptr) return;
+                i = (i + 1) & mask;
+            }
+            table[i] = ptr;
         }
-        void destroy_and_deallocate(node_type* ptr)
+        static bool find_hp(
+            node_type* const* table, uint64_t mask, node_type* ptr
+        )
         {
-            m_allocator.destroy(ptr);
-            m_allocator.deallocate(ptr, 1);
+            auto i = hash_pointer(ptr) & mask;
+            while(table[i])
+            {
+                if(table[i] == ptr) return true;
+                i = (i + 1) & mask;
+            }
+            return false;
         }
 
-        allocator_type& get_allocator()
+        void collect_hps(hps_table_type& table)
         {
-            return m_allocator;
+            std::array<node_type*, HP_NUM * MAX_THREADS_NUMBER> hps;
+            uint64_t total = 0;
+            m_fence.heavy();
+            auto threads_number =
+                m_threads_number.load(std::memory_order_seq_cst);
+            for(uint64_t i = 0; i < threads_number; ++i)
+            {
+                auto& thread_data = m_threads_data[i];
+
+                for(uint64_t j = 0; j < HP_NUM; ++j)
+                {
+                    auto ptr = thread_data.thread_hps[j].load(
+                        std::memory_order_consume
+                    );
+                    if (ptr) hps[total++] = ptr;
+                }
+            }
+
+            table.total = total;
+            table.mask = round_up_pow2(2 * total) - 1;
+            std::fill_n(table.data.data(), table.mask + 1, nullptr);
+            for(uint64_t i = 0; i < total; ++i)
+            {
+                insert_hp(table.data.data(), table.mask, hps[i]);
+            }
+        }
+        // busy pointers are compacted to the beginning of ptrs,
+        // returns their number
+        uint64_t reclaim(
+            uint64_t thread_index,
+            const hps_table_type& table,
+            node_type** ptrs,
+            uint64_t number
+        ) {
+            uint64_t busy_ptrs_cnt = 0;
+            for(uint64_t i = 0; i < number; ++i)
+            {
+                auto ptr = ptrs[i];
+                assert(ptr != nullptr);
+                if(table.total && find_hp(table.data.data(), table.mask, ptr))
+                {
+                    ptrs[busy_ptrs_cnt++] = ptr;
+                    continue;
+                }
+                cache_node(thread_index, ptr);
+            }
+            return busy_ptrs_cnt;
+        }
+        // returns the number of reclaimed nodes
+        uint64_t reclaim(
+            uint64_t thread_index,
+            const hps_table_type& table,
+            orphans_holder<node_type*>& holder
+        ) {
+            auto ptrs = holder.take();
+            if(ptrs.empty()) return 0;
+            auto number = ptrs.size();
+            ptrs.resize(reclaim(thread_index, table, ptrs.data(), number));
+            number -= ptrs.size();
+            holder.push(std::move(ptrs));
+            return number;
+        }
+
+        void erase(uint64_t thread_index)
+        {
+            hps_table_type table;
+            collect_hps(table);
+
+            auto& thread_data = m_threads_data[thread_index];
+            thread_data.free_ptrs_index = reclaim(
+                thread_index,
+                table,
+                thread_data.free_ptrs.data(),
+                thread_data.free_ptrs_index
+            );
+            reclaim(thread_index, table, m_orphans);
+        }
+
+        // false if the reclaimer lags behind, the caller scans by itself;
+        // nothing is allocated and the reclaimer is woken only if parked
+        bool hand_off(uint64_t thread_index)
+        {
+            auto& thread_data = m_threads_data[thread_index];
+            auto number = thread_data.free_ptrs_index;
+            if(thread_data.handed_off_number.load(std::memory_order_acquire))
+                return false;
+            if(m_pending_nodes.fetch_add(number, std::memory_order_relaxed) +
+               number > reclamation_type::MAX_PENDING_NODES
+            ) {
+                m_pending_nodes.fetch_sub(number, std::memory_order_relaxed);
+                return false;
+            }
+
+            std::copy_n(
+                thread_data.free_ptrs.data(),
+                number,
+                thread_data.handed_off_ptrs.data()
+            );
+            thread_data.handed_off_number.store(
+                number, std::memory_order_release
+            );
+            thread_data.free_ptrs_index = 0;
+            // pairs with the fence of the reclaimer before it parks,
+            // a missed wakeup costs at most RECLAIMER_PERIOD_MSEC
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if(m_reclaimer_parked.load(std::memory_order_relaxed) &&
+               m_reclaimer_parked.exchange(false, std::memory_order_relaxed)
+            ) m_reclaimer_cv.notify_one();
+            return true;
+        }
+        // the batches are taken before the scan, so every node in them
+        // was unlinked before the hazard pointers are read
+        void reclaimer_loop()
+        {
+            std::array<uint64_t, MAX_THREADS_NUMBER> numbers;
+            bool idle = true;
+            std::unique_lock<std::mutex> lck(m_reclaimer_lock);
+            while(!m_reclaimer_stop.load(std::memory_order_relaxed))
+            {
+                // while batches keep coming the reclaimer doesn't park,
+                // so the workers don't pay for the wakeup
+                if(idle)
+                {
+                    m_reclaimer_parked.store(true, std::memory_order_relaxed);
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    m_reclaimer_cv.wait_for(
+                        lck, std::chrono::milliseconds(RECLAIMER_PERIOD_MSEC)
+                    );
+                    m_reclaimer_parked.store(false, std::memory_order_relaxed);
+                }
+                lck.unlock();
+                idle = true;
+
+                auto threads_number =
+                    m_threads_number.load(std::memory_order_acquire);
+                for(uint64_t i = 0; i < threads_number; ++i)
+                {
+                    numbers[i] = m_threads_data[i].handed_off_number.load(
+                        std::memory_order_acquire
+                    );
+                }
+                hps_table_type table;
+                collect_hps(table);
+
+                uint64_t reclaimed = m_reclaimer_busy.size();
+                m_reclaimer_busy.resize(reclaim(
+                    RECLAIMER_INDEX,
+                    table,
+                    m_reclaimer_busy.data(),
+                    m_reclaimer_busy.size()
+                ));
+                reclaimed -= m_reclaimer_busy.size();
+                for(uint64_t i = 0; i < threads_number; ++i)
+                {
+                    if(!numbers[i]) continue;
+                    idle = false;
+                    auto& thread_data = m_threads_data[i];
+                    auto ptrs = thread_data.handed_off_ptrs.data();
+                    auto busy = reclaim(
+                        RECLAIMER_INDEX, table, ptrs, numbers[i]
+                    );
+                    m_reclaimer_busy.insert(
+                        m_reclaimer_busy.end(), ptrs, ptrs + busy
+                    );
+                    reclaimed += numbers[i] - busy;
+                    thread_data.handed_off_number.store(
+                        0, std::memory_order_release
+                    );
+                }
+                m_pending_nodes.fetch_sub(reclaimed, std::memory_order_relaxed);
+                reclaim(RECLAIMER_INDEX, table, m_orphans);
+                // workers take reclaimed nodes from the shared pool
+                spill_cached_nodes(
+                    RECLAIMER_INDEX,
+                    m_threads_data[RECLAIMER_INDEX].cached_nodes_index
+                );
+
+                if(!idle) std::this_thread::yield();
+                lck.lock();
+            }
         }
 
     private:
-        allocator_type m_allocator;
+        std::atomic<uint64_t> m_threads_number;
+        std::atomic<uint64_t> m_scan_threshold;
+        fence_type m_fence;
+        allocator_holder_type m_allocator_holder;
+        orphans_holder<node_type*> m_orphans;
+        std::array<thread_data_entry_type, MAX_THREADS_NUMBER + 1> m_threads_data;
+        std::atomic<node_type*> m_shared_nodes;
+        std::atomic<uint64_t> m_shared_nodes_number;
+        std::atomic<uint64_t> m_pending_nodes; // handed off, not freed yet
+        std::vector<node_type*> m_reclaimer_busy; // the reclaimer only
+        std::atomic<bool> m_reclaimer_stop;
+        std::atomic<bool> m_reclaimer_parked;
+        std::mutex m_reclaimer_lock;
+        std::condition_variable m_reclaimer_cv;
+        std::thread m_reclaimer;
     };
 
-	
+    // epoch based reclamation with the hp_manager interface: set_hp
+    // at position 0 pins the current epoch, set_hp(.., 0, nullptr) unpins it,
+    // other positions are ignored
     template<
         uint64_t MaxThreadsNumber,
         typename T,
         typename Allocator,
         typename BackOff = wait_backoff
-    > class hp_manager: boost::noncopyable
+    > class ebr_manager: boost::noncopyable
     {
     public:
         static constexpr uint64_t MAX_THREADS_NUMBER = MaxThreadsNumber;
         static constexpr uint64_t K = 2;
         static constexpr uint64_t HP_NUM = 8;
         static constexpr uint64_t FREE_PTR_NUM = K * HP_NUM * MAX_THREADS_NUMBER;
-        static constexpr uint64_t CURRENT_THREAD_ID = -1;
+        static constexpr uint64_t ACTIVE_FLAG = 0x1;
+        static constexpr bool NEED_HP_VALIDATION = false;
 
         using node_type = T;
         using value_type = typename T::value_type;
@@ -496,57 +2642,78 @@ namespace lock_free
 
         struct thread_data_entry_type
         {
-            std::array<std::atomic<node_type*>, HP_NUM> thread_hps = {};
-            uint64_t free_ptrs_index = 0;
-            std::array<node_type*, FREE_PTR_NUM> free_ptrs = {};
+            thread_data_entry_type(): local_epoch(0) {}
+
+            std::atomic<uint64_t> local_epoch; // (epoch << 1) | ACTIVE_FLAG
+            char padding[128 - sizeof local_epoch];
+            bool is_pinned = false;
+            uint64_t next_scan = FREE_PTR_NUM;
+            // retired node and the global epoch at the moment of retirement
+            std::vector<std::pair<node_type*, uint64_t>> free_ptrs;
         };
 
     public:
-        hp_manager() = default;
-        ~hp_manager()
+        ebr_manager(): m_global_epoch(0), m_threads_number(0) {}
+        ~ebr_manager()
         {
-            for(uint64_t i = 0; i < m_threads_number; ++i)
+            for(auto& ref : m_orphans.take())
             {
-                auto& thread_data = m_threads_data[i];
-                auto& free_ptrs = thread_data.free_ptrs;
-                for(uint64_t j = 0; j < thread_data.free_ptrs_index; ++j)
+                physically_remove_node(ref.first);
+            }
+            for(auto& thread_data : m_threads_data)
+            {
+                for(auto& ref : thread_data.free_ptrs)
                 {
-                    physically_remove_node(free_ptrs[j]);
+                    physically_remove_node(ref.first);
                 }
             }
         }
 
-        void thread_init(uint64_t /*thread_index*/) {}
+        void thread_init(uint64_t thread_index)
+        {
+            update_threads_number(thread_index + 1);
+        }
+        // the thread with thread_index has exited, its slot may be reused
+        void thread_release(uint64_t thread_index)
+        {
+            auto& thread_data = m_threads_data[thread_index];
+            unpin(thread_index);
+            m_orphans.push(std::move(thread_data.free_ptrs));
+            thread_data.free_ptrs.clear();
+            thread_data.next_scan = FREE_PTR_NUM;
+        }
         void init(
             uint64_t threads_number,
             uint64_t /*init_nodes_number*/,
             uint64_t /*max_nodes_number*/
         ) {
-            m_threads_number = threads_number;
+            update_threads_number(threads_number);
         }
 
         void set_hp(uint64_t thread_index, uint64_t pos, node_type* ptr)
         {
-            auto& thread_data_entry = m_threads_data[thread_index];
-            thread_data_entry.thread_hps[pos].store(
-                ptr, std::memory_order_release
-            );
+            if(pos != 0) return;
+            if(ptr) pin(thread_index);
+            else unpin(thread_index);
         }
-        node_type* get_hp(uint64_t thread_index, uint64_t pos)
+        node_type* get_hp(uint64_t /*thread_index*/, uint64_t /*pos*/)
         {
-            auto& thread_data_entry = m_threads_data[thread_index];
-            return thread_data_entry.thread_hps[pos].load(
-                std::memory_order_acquire
-            );
+            return nullptr;
         }
 
         void remove_node(uint64_t thread_index, node_type* ptr)
         {
-            auto& thread_data_entry = m_threads_data[thread_index];
-            thread_data_entry.free_ptrs[thread_data_entry.free_ptrs_index++] = ptr;
-            if(thread_data_entry.free_ptrs_index == FREE_PTR_NUM)
+            auto& thread_data = m_threads_data[thread_index];
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            thread_data.free_ptrs.emplace_back(
+                ptr, m_global_epoch.load(std::memory_order_relaxed)
+            );
+            if(thread_data.free_ptrs.size() >= thread_data.next_scan)
             {
                 erase(thread_index);
+                // a stalled reader keeps the epoch, don't rescan on every call
+                thread_data.next_scan =
+                    thread_data.free_ptrs.size() + FREE_PTR_NUM;
             }
         }
         // if ptr wasn't in the chain (it is yet unused)
@@ -567,55 +2734,323 @@ namespace lock_free
         }
 
     private:
+        void update_threads_number(uint64_t threads_number)
+        {
+            auto number = m_threads_number.load(std::memory_order_relaxed);
+            while(number < threads_number &&
+                  !m_threads_number.compare_exchange_weak(
+                      number, threads_number, std::memory_order_seq_cst
+                  )
+            );
+        }
+
+        void pin(uint64_t thread_index)
+        {
+            auto& thread_data = m_threads_data[thread_index];
+            if(thread_data.is_pinned) return;
+            thread_data.is_pinned = true;
+
+            auto epoch = m_global_epoch.load(std::memory_order_relaxed);
+            while(true)
+            {
+                thread_data.local_epoch.store(
+                    (epoch << 1) | ACTIVE_FLAG, std::memory_order_relaxed
+                );
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                auto current = m_global_epoch.load(std::memory_order_relaxed);
+                if(current == epoch) break;
+                epoch = current;
+            }
+        }
+        void unpin(uint64_t thread_index)
+        {
+            auto& thread_data = m_threads_data[thread_index];
+            if(!thread_data.is_pinned) return;
+            thread_data.is_pinned = false;
+            thread_data.local_epoch.store(0, std::memory_order_release);
+        }
+
+        void try_advance()
+        {
+            auto epoch = m_global_epoch.load(std::memory_order_seq_cst);
+            auto threads_number =
+                m_threads_number.load(std::memory_order_seq_cst);
+            for(uint64_t i = 0; i < threads_number; ++i)
+            {
+                auto local = m_threads_data[i].local_epoch.load(
+                    std::memory_order_seq_cst
+                );
+                if((local & ACTIVE_FLAG) && (local >> 1) != epoch) return;
+            }
+            m_global_epoch.compare_exchange_strong(
+                epoch, epoch + 1, std::memory_order_seq_cst
+            );
+        }
+
         void erase(uint64_t thread_index)
         {
-            std::array<node_type*, HP_NUM * MAX_THREADS_NUMBER> hps;
-            uint64_t total = 0;
-            for(uint64_t i = 0; i < m_threads_number; ++i)
+            try_advance();
+            auto epoch = m_global_epoch.load(std::memory_order_acquire);
+            auto& free_ptrs = m_threads_data[thread_index].free_ptrs;
+
+            // nobody can hold a node retired two epochs ago
+            uint64_t busy_ptrs_cnt = 0;
+            for(auto& ref : free_ptrs)
             {
-                auto& thread_data = m_threads_data[i];
+                if(ref.second + 2 <= epoch)
+                {
+                    m_allocator_holder.destroy_and_deallocate(ref.first);
+                    continue;
+                }
+                free_ptrs[busy_ptrs_cnt++] = ref;
+            }
+            free_ptrs.resize(busy_ptrs_cnt);
 
-                for(uint64_t j = 0; j < HP_NUM; ++j)
+            auto orphans = m_orphans.take();
+            if(orphans.empty()) return;
+            busy_ptrs_cnt = 0;
+            for(auto& ref : orphans)
+            {
+                if(ref.second + 2 <= epoch)
                 {
-                    auto ptr = thread_data.thread_hps[j].load(
-                        std::memory_order_consume
+                    m_allocator_holder.destroy_and_deallocate(ref.first);
+                    continue;
+                }
+                orphans[busy_ptrs_cnt++] = ref;
+            }
+            orphans.resize(busy_ptrs_cnt);
+            m_orphans.push(std::move(orphans));
+        }
+
+    private:
+        std::atomic<uint64_t> m_global_epoch;
+        char padding1[128 - sizeof m_global_epoch];
+        std::atomic<uint64_t> m_threads_number;
+        allocator_holder_type m_allocator_holder;
+        orphans_holder<std::pair<node_type*, uint64_t>> m_orphans;
+        std::array<thread_data_entry_type, MAX_THREADS_NUMBER> m_threads_data;
+    };
+
+    // interval based reclamation (2GE-IBR): an operation reserves the
+    // interval of eras [lower, upper] it has seen, a retired node is
+    // freed if its [birth_era, retire_era] meets no reservation.
+    // set_hp publishes an era only when the era clock has moved,
+    // a stalled thread keeps only the nodes born before its upper era
+    template<
+        uint64_t MaxThreadsNumber,
+        typename T,
+        typename Allocator,
+        typename BackOff = wait_backoff
+    > class ibr_manager: boost::noncopyable
+    {
+    public:
+        static constexpr uint64_t MAX_THREADS_NUMBER = MaxThreadsNumber;
+        static constexpr uint64_t K = 2;
+        static constexpr uint64_t HP_NUM = 8;
+        static constexpr uint64_t FREE_PTR_NUM = K * HP_NUM * MAX_THREADS_NUMBER;
+        // retirements of a thread between the era clock increments
+        static constexpr uint64_t ERA_FREQ = 2 * HP_NUM;
+        static constexpr uint64_t INACTIVE_ERA = -1;
+        // containers must re-read the source after set_hp
+        static constexpr bool NEED_HP_VALIDATION = true;
+
+        using node_type = T;
+        using value_type = typename T::value_type;
+        using allocator_type =
+            typename Allocator::template rebind<node_type>::other;
+        using allocator_holder_type = allocator_holder<allocator_type>;
+        using backoff_strategy_type = BackOff;
+
+        struct thread_data_entry_type
+        {
+            thread_data_entry_type(): lower_era(INACTIVE_ERA), upper_era(0) {}
+
+            std::atomic<uint64_t> lower_era; // INACTIVE_ERA out of operation
+            std::atomic<uint64_t> upper_era;
+            char padding[128 - sizeof lower_era - sizeof upper_era];
+            uint64_t retired_number = 0;
+            uint64_t next_scan = FREE_PTR_NUM;
+            std::vector<node_type*> free_ptrs;
+        };
+
+    public:
+        ibr_manager(): m_era(1), m_threads_number(0) {}
+        ~ibr_manager()
+        {
+            for(auto ptr : m_orphans.take())
+            {
+                physically_remove_node(ptr);
+            }
+            for(auto& thread_data : m_threads_data)
+            {
+                for(auto ptr : thread_data.free_ptrs)
+                {
+                    physically_remove_node(ptr);
+                }
+            }
+        }
+
+        void thread_init(uint64_t thread_index)
+        {
+            update_threads_number(thread_index + 1);
+        }
+        // the thread with thread_index has exited, its slot may be reused
+        void thread_release(uint64_t thread_index)
+        {
+            auto& thread_data = m_threads_data[thread_index];
+            thread_data.lower_era.store(INACTIVE_ERA, std::memory_order_release);
+            m_orphans.push(std::move(thread_data.free_ptrs));
+            thread_data.free_ptrs.clear();
+            thread_data.next_scan = FREE_PTR_NUM;
+        }
+        void init(
+            uint64_t threads_number,
+            uint64_t /*init_nodes_number*/,
+            uint64_t /*max_nodes_number*/
+        ) {
+            update_threads_number(threads_number);
+        }
+
+        // clearing of the position 0 ends the operation
+        void set_hp(uint64_t thread_index, uint64_t pos, node_type* ptr)
+        {
+            auto& thread_data = m_threads_data[thread_index];
+            if(!ptr)
+            {
+                if(pos == 0)
+                {
+                    thread_data.lower_era.store(
+                        INACTIVE_ERA, std::memory_order_release
                     );
-                    if (!ptr) break;
-                    hps[total++] = ptr;
                 }
+                return;
             }
 
-            // may be use radix sort
-            auto begin = hps.data();
-            auto end = begin + total;
-            std::sort(begin, end);
-            uint64_t busy_ptrs_cnt = 0;
-            std::array<node_type*, HP_NUM * MAX_THREADS_NUMBER> busy_ptrs;
+            auto era = m_era.load(std::memory_order_acquire);
+            if(thread_data.lower_era.load(std::memory_order_relaxed) ==
+               INACTIVE_ERA
+            ) {
+                thread_data.upper_era.store(era, std::memory_order_seq_cst);
+                thread_data.lower_era.store(era, std::memory_order_seq_cst);
+                return;
+            }
+            if(thread_data.upper_era.load(std::memory_order_relaxed) != era)
+            {
+                thread_data.upper_era.store(era, std::memory_order_seq_cst);
+            }
+        }
+        node_type* get_hp(uint64_t /*thread_index*/, uint64_t /*pos*/)
+        {
+            return nullptr;
+        }
+
+        void remove_node(uint64_t thread_index, node_type* ptr)
+        {
             auto& thread_data = m_threads_data[thread_index];
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            ptr->retire_era = m_era.load(std::memory_order_relaxed);
+            thread_data.free_ptrs.push_back(ptr);
+            if(++thread_data.retired_number % ERA_FREQ == 0)
+            {
+                m_era.fetch_add(1, std::memory_order_acq_rel);
+            }
+            if(thread_data.free_ptrs.size() >= thread_data.next_scan)
+            {
+                erase(thread_index);
+                // the nodes of a stalled reader survive, don't rescan at once
+                thread_data.next_scan =
+                    thread_data.free_ptrs.size() + FREE_PTR_NUM;
+            }
+        }
+        // if ptr wasn't in the chain (it is yet unused)
+        void physically_remove_node(node_type* ptr)
+        {
+            m_allocator_holder.destroy_and_deallocate(ptr);
+        }
+
+        node_type* get_node(uint64_t /*thread_index*/)
+        {
+            auto ptr = m_allocator_holder.allocate_and_construct();
+            ptr->birth_era = m_era.load(std::memory_order_acquire);
+            return ptr;
+        }
+        node_type* get_node(uint64_t /*thread_index*/, const value_type& val)
+        {
+            auto ptr = get_node(uint64_t());
+            ptr->value = val;
+            return ptr;
+        }
+
+    private:
+        void update_threads_number(uint64_t threads_number)
+        {
+            auto number = m_threads_number.load(std::memory_order_relaxed);
+            while(number < threads_number &&
+                  !m_threads_number.compare_exchange_weak(
+                      number, threads_number, std::memory_order_seq_cst
+                  )
+            );
+        }
 
-            // в free_ptrs самые свежие указатели в конце массива - optimize
-            // свежие - т.е. могут быть в hazard pointers
-            for(auto ptr : thread_data.free_ptrs)
+        // the nodes with intersecting reservations are left in ptrs
+        void reclaim(
+            const std::pair<uint64_t, uint64_t>* intervals,
+            uint64_t intervals_number,
+            std::vector<node_type*>& ptrs
+        ) {
+            uint64_t busy_ptrs_cnt = 0;
+            for(auto ptr : ptrs)
             {
-                assert(ptr != nullptr);
-                if(std::binary_search(begin, end, ptr))
+                bool busy = false;
+                for(uint64_t i = 0; i < intervals_number && !busy; ++i)
+                {
+                    busy = ptr->birth_era <= intervals[i].second &&
+                           intervals[i].first <= ptr->retire_era;
+                }
+                if(busy)
                 {
-                    busy_ptrs[busy_ptrs_cnt++] = ptr;
+                    ptrs[busy_ptrs_cnt++] = ptr;
                     continue;
                 }
                 m_allocator_holder.destroy_and_deallocate(ptr);
             }
-            std::copy(
-                busy_ptrs.data(),
-                busy_ptrs.data() + busy_ptrs_cnt,
-                thread_data.free_ptrs.data()
-            );
-            thread_data.free_ptrs_index = busy_ptrs_cnt;
+            ptrs.resize(busy_ptrs_cnt);
+        }
+
+        void erase(uint64_t thread_index)
+        {
+            std::array<
+                std::pair<uint64_t, uint64_t>, MAX_THREADS_NUMBER
+            > intervals;
+            uint64_t total = 0;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            auto threads_number =
+                m_threads_number.load(std::memory_order_seq_cst);
+            for(uint64_t i = 0; i < threads_number; ++i)
+            {
+                auto& ref = m_threads_data[i];
+                auto lower = ref.lower_era.load(std::memory_order_seq_cst);
+                if(lower == INACTIVE_ERA) continue;
+                intervals[total++] = std::make_pair(
+                    lower, ref.upper_era.load(std::memory_order_seq_cst)
+                );
+            }
+
+            auto& thread_data = m_threads_data[thread_index];
+            reclaim(intervals.data(), total, thread_data.free_ptrs);
+
+            auto orphans = m_orphans.take();
+            if(orphans.empty()) return;
+            reclaim(intervals.data(), total, orphans);
+            m_orphans.push(std::move(orphans));
         }
 
     private:
-        uint64_t m_threads_number = 0;
+        std::atomic<uint64_t> m_era;
+        char padding1[128 - sizeof m_era];
+        std::atomic<uint64_t> m_threads_number;
         allocator_holder_type m_allocator_holder;
+        orphans_holder<node_type*> m_orphans;
         std::array<thread_data_entry_type, MAX_THREADS_NUMBER> m_threads_data;
     };
 	//
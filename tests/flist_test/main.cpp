@@ -93,6 +93,40 @@ int main(int /*argc*/, char** /*argv*/)
     using namespace tools;
 
     lock_free::hp::flist<8, size_t, lock_free::empty_backoff> structure;
+//    lock_free::hp::flist<
+//        8,
+//        size_t,
+//        lock_free::empty_backoff,
+//        lock_free::hp_manager<
+//            8,
+//            lock_free::hp_node<size_t>,
+//            std::allocator<size_t>,
+//            lock_free::empty_backoff,
+//            lock_free::membarrier_hp_fence
+//        >
+//    > structure;
+//    lock_free::hp::flist<
+//        8,
+//        size_t,
+//        lock_free::empty_backoff,
+//        lock_free::ebr_manager<
+//            8,
+//            lock_free::hp_node<size_t>,
+//            std::allocator<size_t>,
+//            lock_free::empty_backoff
+//        >
+//    > structure;
+//    lock_free::hp::flist<
+//        8,
+//        size_t,
+//        lock_free::empty_backoff,
+//        lock_free::ibr_manager<
+//            8,
+//            lock_free::hp_node<size_t>,
+//            std::allocator<size_t>,
+//            lock_free::empty_backoff
+//        >
+//    > structure;
 //    locked::flist<
 //        size_t,
 //        lock_free::spin_lock<lock_free::basic_backoff>
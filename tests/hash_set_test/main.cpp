@@ -95,6 +95,20 @@ int main(int /*argc*/, char** /*argv*/)
     lock_free::hp::static_closed_hash_set<
         8, 1 * 1024 * 1024, size_t
     > structure(2);
+//    lock_free::hp::static_closed_hash_set<
+//        8,
+//        1 * 1024 * 1024,
+//        size_t,
+//        lock_free::empty_backoff,
+//        std::hash<size_t>,
+//        std::allocator<size_t>,
+//        lock_free::ebr_manager<
+//            8,
+//            lock_free::hp::hash_node<size_t>,
+//            std::allocator<size_t>,
+//            lock_free::empty_backoff
+//        >
+//    > structure(2);
 //    locked::striped_unordered_set<size_t, 1024 * 4> structure;
 
     constexpr size_t WAIT_NUM = 10;
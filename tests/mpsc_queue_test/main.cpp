@@ -0,0 +1,121 @@
+
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <future>
+#include <memory>
+#include <vector>
+
+#include <other/mpsc_queue.hpp>
+#include <hp/queue.hpp>
+
+
+
+namespace tools
+{
+    // the link field is embedded, the producers never allocate
+    struct message: lock_free::mpsc_hook
+    {
+        size_t value = 0;
+    };
+
+    struct results_data
+    {
+        size_t popped = 0;
+        size_t sum = 0;
+        size_t msec = 0;
+    };
+
+    constexpr size_t prod_thread_num = 4;
+    constexpr size_t values_per_producer = 1000000;
+    constexpr size_t total = prod_thread_num * values_per_producer;
+
+    template <typename Push, typename Pop>
+    results_data run(Push push, Pop pop)
+    {
+        std::vector<std::future<void>> prod_arr;
+        std::atomic<bool> start(false);
+        results_data res;
+
+        for(size_t i = 0; i < prod_thread_num; ++i)
+        {
+            prod_arr.push_back(std::async(
+                std::launch::async,
+                [&push, &start, i] () {
+                    while(!start);
+                    for(size_t j = 0; j < values_per_producer; ++j)
+                        push(i, j, i * values_per_producer + j + 1);
+                }
+            ));
+        }
+        auto ts1 = std::chrono::high_resolution_clock::now();
+        start = true;
+        size_t value = 0;
+        while(res.popped < total)
+        {
+            if(!pop(value)) continue;
+            ++res.popped;
+            res.sum += value;
+        }
+        auto ts2 = std::chrono::high_resolution_clock::now();
+        for(auto& ref : prod_arr) ref.wait();
+        res.msec = std::chrono::duration_cast<std::chrono::milliseconds>(
+            ts2 - ts1
+        ).count();
+
+        return res;
+    }
+
+    void print(const char* name, const results_data& res)
+    {
+        std::cout << name << ", producers: " << prod_thread_num
+            << ", consumers: 1" << std::endl;
+        std::cout << "  popped: " << res.popped << std::endl;
+        std::cout << "  msec: " << res.msec << std::endl;
+        std::cout << "  pops/msec: "
+            << (res.msec ? res.popped / res.msec : 0) << std::endl;
+        std::cout << "  sum: "
+            << (res.sum == total * (total + 1) / 2 ? "ok" : "wrong")
+            << std::endl;
+    }
+}
+
+
+int main(int /*argc*/, char** /*argv*/)
+{
+    using namespace tools;
+
+    {
+        lock_free::mpsc_queue<message> structure;
+        std::vector<std::unique_ptr<message[]>> messages;
+        for(size_t i = 0; i < prod_thread_num; ++i)
+            messages.emplace_back(new message[values_per_producer]);
+        auto res = run(
+            [&structure, &messages] (size_t i, size_t j, size_t value) {
+                auto& ref = messages[i][j];
+                ref.value = value;
+                structure.push(&ref);
+            },
+            [&structure] (size_t& value) {
+                auto ptr = structure.pop();
+                if(!ptr) return false;
+                value = ptr->value;
+                return true;
+            }
+        );
+        print("mpsc_queue", res);
+    }
+    {
+        lock_free::hp::queue<prod_thread_num + 1, size_t> structure;
+        auto res = run(
+            [&structure] (size_t, size_t, size_t value) {
+                structure.push(value);
+            },
+            [&structure] (size_t& value) { return structure.pop(value); }
+        );
+        print("hp::queue", res);
+    }
+
+    return 0;
+}
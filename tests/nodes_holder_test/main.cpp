@@ -0,0 +1,99 @@
+
+#include <iostream>
+
+#include <technical.hpp>
+
+
+
+using namespace lock_free;
+using tptrs_type = tptrs;
+using node_type = node<size_t, tptrs_type>;
+using holder_type = queue_nodes_holder<node_type, wait_backoff, tptrs_type>;
+
+// a pusher of tp::queue reads tail and tail->next, then is preempted
+// before its CAS on tail->next; meanwhile the tail node gets a successor,
+// is popped as the dummy and saved to the free nodes, where it is the
+// tail again with a null next; the stale CAS must not link the pushed
+// node into the free nodes, the value would be lost
+bool test_stale_link()
+{
+    node_type dummy;
+    node_type tail_node(1);
+    node_type next_node(2);
+    node_type pushed_node(42);
+    holder_type holder(&dummy);
+    auto tail = tptrs_type::set(&tail_node, 0);
+    auto pushed = tptrs_type::set(&pushed_node, 0);
+
+    // the stale pusher
+    auto tnext = tail_node.next.load();
+
+    // the other threads push after the tail node and pop it
+    tail_node.next.store(tptrs_type::set(&next_node, 0));
+    holder.save_node(tail);
+
+    // the stale pusher resumes, as tp::queue::push links
+    pushed_node.reset_next();
+    bool linked = tail_node.next.compare_exchange_strong(
+        tnext, node_type::link(tnext, pushed)
+    );
+
+    size_t free_number = 0;
+    while(!tptrs_type::is_null(holder.get_node())) ++free_number;
+
+    std::cout << "stale link after reuse" << std::endl;
+    std::cout << "  linked: " << (linked ? "wrong" : "ok") << std::endl;
+    std::cout << "  free nodes: " << free_number
+        << (free_number == 1 ? " ok" : " wrong") << std::endl;
+
+    return !linked && free_number == 1;
+}
+
+// a popper reads head = node and its next, then is preempted before
+// its CAS on head; meanwhile the node is popped, saved again and gets
+// to the head once more. The head must not repeat the tagged value the
+// popper has read, or its CAS moves head to a node already popped.
+// The head a pop has left is given back by get_node with its counter
+// incremented, so the two values are compared through it
+bool test_stale_head()
+{
+    node_type dummy;
+    node_type node(1);
+    node_type first_pred(2), second_pred(3);
+    node_type first_next(4), second_next(5);
+    holder_type holder(&dummy);
+    auto ptr = tptrs_type::set(&node, 0);
+
+    // the node gets to the head after a fresh predecessor
+    holder.save_node(tptrs_type::set(&first_pred, 0));
+    holder.save_node(ptr);
+    holder.save_node(tptrs_type::set(&first_next, 0));
+    holder.get_node(); // dummy
+    holder.get_node(); // first_pred
+    auto first = holder.get_node(); // the node, what a stale pop has read
+
+    // and once more after another fresh predecessor
+    holder.save_node(tptrs_type::set(&second_pred, 0));
+    holder.save_node(first);
+    holder.save_node(tptrs_type::set(&second_next, 0));
+    holder.get_node(); // first_next
+    holder.get_node(); // second_pred
+    auto second = holder.get_node(); // the node again
+
+    bool same = node_type::is_same(first, ptr) &&
+        node_type::is_same(second, ptr) &&
+        tptrs_type::get_counter(first) == tptrs_type::get_counter(second);
+
+    std::cout << "stale head after reuse" << std::endl;
+    std::cout << "  head repeated: " << (same ? "wrong" : "ok") << std::endl;
+
+    return !same;
+}
+
+int main(int /*argc*/, char** /*argv*/)
+{
+    bool ok = test_stale_link();
+    ok = test_stale_head() && ok;
+
+    return ok ? 0 : 1;
+}
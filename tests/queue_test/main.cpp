@@ -13,9 +13,12 @@
 #include <boost/lockfree/queue.hpp>
 
 #include <tp/queue.hpp>
+#include <tp/relaxed_queue.hpp>
 #include <hp/queue.hpp>
+#include <hp/segment_queue.hpp>
 #include <locked/queue.hpp>
 #include <other/queue.hpp>
+#include <other/ring_queue.hpp>
 
 
 
@@ -120,13 +123,51 @@ int main(int /*argc*/, char** /*argv*/)
 //            lock_free::wait_backoff
 //        >
 //    > structure;
+//    lock_free::hp::queue<
+//        10,
+//        size_t,
+//        lock_free::hp_manager<
+//            10,
+//            lock_free::hp_node<size_t>,
+//            std::allocator<size_t>,
+//            lock_free::wait_backoff,
+//            lock_free::symmetric_hp_fence,
+//            lock_free::background_reclamation<>
+//        >
+//    > structure;
+//    lock_free::hp::segment_queue<
+//        10,
+//        size_t,
+//        lock_free::hp_manager<
+//            10,
+//            lock_free::hp::segment_node<size_t, 1024>,
+//            std::allocator<size_t>,
+//            lock_free::wait_backoff
+//        >
+//    > structure;
 //    locked::locked_queue<
 //        size_t, lock_free::spin_lock<lock_free::basic_backoff>
 //    > structure;
 //    lock_free::tp::queue<
 //        2, 1, size_t, lock_free::wait_backoff
 //    > structure(50000, 0);
+//    lock_free::tp::queue<
+//        2, 1, size_t, lock_free::wait_backoff,
+//        std::allocator<size_t>, lock_free::wide_tptrs // -mcx16
+//    > structure(50000, 0);
+//    using index_tptrs_type = lock_free::index_tptrs<1024 * 1024>;
+//    lock_free::tp::queue<
+//        2, 1, size_t, lock_free::wait_backoff,
+//        index_tptrs_type::allocator<size_t>, index_tptrs_type
+//    > structure(50000, 0);
+//    lock_free::tp::relaxed_queue<
+//        2, 2, size_t, lock_free::wait_backoff
+//    > structure(50000, 0); // approximate FIFO
 //    other::two_threads_queue<128 * 1024, size_t> structure; // spsc_queue
+//    other::two_threads_queue<128 * 1024, size_t, 32> structure; // + flush()
+//    auto& structure = get_structure<
+//        lock_free::ring_queue<1024 * 64, size_t, lock_free::wait_backoff>
+//    >();
 //    auto& structure = get_structure<
 //        boost::lockfree::queue<size_t>
 //    >(1024 * 64 - 1);
@@ -280,7 +321,7 @@ int main(int /*argc*/, char** /*argv*/)
     std::cout << "  min_cons_nsec: " << average_cons_stat.min_cons_nsec << std::endl;
     std::cout << "  average_cons_nsec: "
         << average_cons_stat.average_cons_nsec << std::endl;
-    //std::cout << "nodes cnt: " << structure.get_nodes_count() << std::endl;
+    //std::cout << "nodes cnt: " << structure.get_nodes_count(0) << std::endl;
 
     return 0;
 }
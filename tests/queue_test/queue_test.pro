@@ -5,7 +5,7 @@ CONFIG += console
 CONFIG -= app_bundle
 CONFIG -= qt
 
-QMAKE_CXXFLAGS += -std=c++14 -Wall -Wextra -pedantic -O3 -pthread
+QMAKE_CXXFLAGS += -std=c++14 -Wall -Wextra -pedantic -O3 -pthread -mcx16
 QMAKE_LFLAGS += -lpthread
 INCLUDEPATH += ./../../
 DESTDIR = build
@@ -13,9 +13,12 @@ OBJECTS_DIR = build
 
 HEADERS += ./../../technical.hpp \
     ./../../tp/queue.hpp \
+    ./../../tp/relaxed_queue.hpp \
     ./../../hp/queue.hpp \
+    ./../../hp/segment_queue.hpp \
     ./../../locked/queue.hpp \
-    ./../../other/queue.hpp
+    ./../../other/queue.hpp \
+    ./../../other/ring_queue.hpp
 
 SOURCES += main.cpp
 
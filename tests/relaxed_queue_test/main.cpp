@@ -0,0 +1,196 @@
+
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <future>
+#include <utility>
+#include <vector>
+
+#include <tp/queue.hpp>
+#include <tp/relaxed_queue.hpp>
+
+
+
+namespace tools
+{
+    template <typename T, typename ... Args>
+    auto& get_structure(Args && ... args)
+    {
+        static T obj{std::forward<Args>(args)...};
+        return obj;
+    }
+
+    uint64_t now_nsec()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()
+        ).count();
+    }
+
+    // the push time is the value, the pop time is taken by the consumer
+    struct pop_record
+    {
+        uint64_t push_nsec;
+        uint64_t pop_nsec;
+    };
+
+    struct results_data
+    {
+        std::vector<pop_record> records;
+        std::future<void> fut;
+        char padding[128 - (sizeof records + sizeof fut)];
+    };
+
+    // rank error of a pop: the number of values pushed before it that
+    // were still in the queue, counted with a Fenwick tree over the
+    // positions in the push order
+    class rank_error
+    {
+    public:
+        rank_error(std::vector<pop_record> records):
+            m_tree(records.size() + 1, 0)
+        {
+            std::sort(
+                records.begin(),
+                records.end(),
+                [] (const pop_record& a, const pop_record& b) {
+                    return a.push_nsec < b.push_nsec;
+                }
+            );
+            for(size_t i = 0; i < records.size(); ++i)
+            {
+                m_pops.push_back(std::make_pair(records[i].pop_nsec, i));
+                add(i, 1);
+            }
+            std::sort(m_pops.begin(), m_pops.end());
+        }
+
+        void calc(double& average, uint64_t& max)
+        {
+            uint64_t total = 0;
+            max = 0;
+            for(auto& ref : m_pops)
+            {
+                uint64_t error = sum(ref.second);
+                total += error;
+                if(error > max) max = error;
+                add(ref.second, -1);
+            }
+            average = m_pops.empty() ? 0 :
+                static_cast<double>(total) / m_pops.size();
+        }
+
+    private:
+        void add(size_t pos, int64_t delta)
+        {
+            for(++pos; pos < m_tree.size(); pos += pos & -pos)
+                m_tree[pos] += delta;
+        }
+        // the number of the values still present in [0, pos)
+        uint64_t sum(size_t pos) const
+        {
+            int64_t result = 0;
+            for(; pos; pos -= pos & -pos) result += m_tree[pos];
+            return result;
+        }
+
+    private:
+        std::vector<std::pair<uint64_t, size_t>> m_pops;
+        std::vector<int64_t> m_tree;
+    };
+}
+
+
+int main(int /*argc*/, char** /*argv*/)
+{
+    using namespace tools;
+
+    constexpr size_t prod_thread_num = 4;
+    constexpr size_t cons_thread_num = 4;
+    constexpr size_t values_per_producer = 500000;
+
+//    auto& structure = get_structure<
+//        lock_free::tp::queue<
+//            prod_thread_num + cons_thread_num, 1, size_t,
+//            lock_free::wait_backoff
+//        >
+//    >();
+    auto& structure = get_structure<
+        lock_free::tp::relaxed_queue<
+            prod_thread_num + cons_thread_num, 4, size_t,
+            lock_free::wait_backoff
+        >
+    >();
+
+    results_data cons_arr[cons_thread_num];
+    std::future<void> prod_arr[prod_thread_num];
+    std::atomic<bool> start(false);
+    std::atomic<size_t> popped(0);
+    constexpr size_t total = prod_thread_num * values_per_producer;
+
+    auto prod_func = [&structure, &start] () mutable -> void
+        {
+            structure.thread_init();
+            while(!start);
+            for(size_t i = 0; i < values_per_producer; ++i)
+            {
+                while(!structure.push(now_nsec()));
+            }
+        };
+    auto cons_func =
+        [&structure, &cons_arr, &start, &popped] (size_t i) mutable -> void
+        {
+            structure.thread_init();
+            auto& records = cons_arr[i].records;
+            records.reserve(total);
+            while(!start);
+            size_t value = 0;
+            size_t local_popped = 0;
+            // the shared counter is flushed rarely and on every miss,
+            // so it is exact once all consumers miss
+            while(popped.load(std::memory_order_relaxed) < total)
+            {
+                if(structure.pop(value))
+                {
+                    records.push_back({value, now_nsec()});
+                    if(++local_popped < 1024) continue;
+                }
+                popped.fetch_add(local_popped, std::memory_order_relaxed);
+                local_popped = 0;
+            }
+        };
+
+    for(size_t i = 0; i < cons_thread_num; ++i)
+        cons_arr[i].fut = std::async(std::launch::async, cons_func, i);
+    for(auto& ref : prod_arr)
+        ref = std::async(std::launch::async, prod_func);
+    auto ts1 = std::chrono::steady_clock::now();
+    start = true;
+    for(auto& ref : prod_arr) ref.wait();
+    for(auto& ref : cons_arr) ref.fut.wait();
+    auto ts2 = std::chrono::steady_clock::now();
+    auto msec =
+        std::chrono::duration_cast<std::chrono::milliseconds>(ts2 - ts1).count();
+
+    std::vector<pop_record> records;
+    for(auto& ref : cons_arr)
+    {
+        records.insert(records.end(), ref.records.begin(), ref.records.end());
+    }
+    double average_error = 0;
+    uint64_t max_error = 0;
+    rank_error(std::move(records)).calc(average_error, max_error);
+
+    std::cout << "producers: " << prod_thread_num
+        << ", consumers: " << cons_thread_num << std::endl;
+    std::cout << "  values: " << total << std::endl;
+    std::cout << "  msec: " << msec << std::endl;
+    std::cout << "  mops/sec: "
+        << (msec ? total / 1000.0 / msec : 0) << std::endl;
+    std::cout << "  average rank error: " << average_error << std::endl;
+    std::cout << "  max rank error: " << max_error << std::endl;
+
+    return 0;
+}
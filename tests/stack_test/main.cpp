@@ -8,6 +8,7 @@
 #include <future>
 #include <utility>
 #include <random>
+#include <vector>
 
 #include <boost/lockfree/stack.hpp>
 
@@ -102,14 +103,46 @@ namespace tools
 }
 
 
-int main(int /*argc*/, char** /*argv*/)
+int main(int argc, char** argv)
 {
     using namespace tools;
 
-//    lock_free::hp::stack<10, size_t> structure;
+//    lock_free::hp::stack<64, size_t> structure;
+//    lock_free::hp::stack<
+//        64, size_t,
+//        lock_free::hp_manager<
+//            64, lock_free::hp_node<size_t>,
+//            std::allocator<size_t>, lock_free::basic_backoff
+//        >,
+//        lock_free::elimination_array<size_t>
+//    > structure;
     lock_free::tp::stack<
-        2, 1, size_t, lock_free::wait_backoff
+        64, 1, size_t, lock_free::wait_backoff
     > structure(500000, 10);
+//    lock_free::tp::stack<
+//        64, 1, size_t, lock_free::wait_backoff,
+//        std::allocator<size_t>, lock_free::tptrs,
+//        lock_free::elimination_array<size_t>
+//    > structure(500000, 10);
+//    lock_free::tp::stack<
+//        64, 1, size_t, lock_free::wait_backoff,
+//        lock_free::slab_allocator<size_t> // pre-faulted slabs
+//    > structure(500000, 10);
+//    lock_free::tp::stack<
+//        64, 1, size_t, lock_free::wait_backoff,
+//        std::allocator<size_t>, lock_free::tptrs,
+//        lock_free::no_elimination, lock_free::no_trimming,
+//        lock_free::pool_statistics<> // get_statistics()
+//    > structure(500000, 10);
+//    lock_free::tp::stack<
+//        64, 1, size_t, lock_free::wait_backoff,
+//        std::allocator<size_t>, lock_free::wide_tptrs // -mcx16
+//    > structure(500000, 10);
+//    using index_tptrs_type = lock_free::index_tptrs<1024 * 1024>;
+//    lock_free::tp::stack<
+//        64, 1, size_t, lock_free::wait_backoff,
+//        index_tptrs_type::allocator<size_t>, index_tptrs_type
+//    > structure(500000, 10);
 //    locked::locked_stack<
 //        size_t,
 //        lock_free::spin_lock<lock_free::basic_backoff>
@@ -125,15 +158,15 @@ int main(int /*argc*/, char** /*argv*/)
 //        >
 //    >();
     constexpr size_t WAIT_NUM = 5;
-    constexpr size_t prod_thread_num = 1;
-    constexpr size_t cons_thread_num = 1;
-    constexpr size_t thread_num = prod_thread_num + prod_thread_num;
-    results_data prod_arr[prod_thread_num];
-    results_data cons_arr[cons_thread_num];
+    // usage: stack_test [producers number] [consumers number]
+    const size_t prod_thread_num = argc > 1 ? std::stoul(argv[1]) : 1;
+    const size_t cons_thread_num =
+        argc > 2 ? std::stoul(argv[2]) : prod_thread_num;
+    std::vector<results_data> prod_arr(prod_thread_num);
+    std::vector<results_data> cons_arr(cons_thread_num);
     std::atomic<bool> start(false);
     std::atomic<bool> stop(false);
     std::atomic<size_t> prod_started_num(0);
-    ((void*)thread_num);
 
     auto prod_func =
         [&structure, &prod_arr, &start, &stop, &prod_started_num]
@@ -260,7 +293,7 @@ int main(int /*argc*/, char** /*argv*/)
     std::cout << "  min_cons_nsec: " << average_cons_stat.min_cons_nsec << std::endl;
     std::cout << "  average_cons_nsec: "
         << average_cons_stat.average_cons_nsec << std::endl;
-    //std::cout << "nodes cnt: " << structure.get_nodes_count() << std::endl;
+    //std::cout << "nodes cnt: " << structure.get_nodes_count(0) << std::endl;
 
     return 0;
 }
@@ -0,0 +1,104 @@
+
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <future>
+
+#include <other/queue.hpp>
+
+
+
+namespace tools
+{
+    constexpr size_t values_num = 10000000;
+    // small to wrap the spans around the end of the ring
+    constexpr uint64_t ring_size = 64;
+    constexpr uint64_t batch_size = 8;
+    // the span sizes cycle through 1..max_span
+    constexpr uint64_t max_span = 13;
+}
+
+
+int main(int /*argc*/, char** /*argv*/)
+{
+    using namespace tools;
+    using structure_type = other::two_threads_queue<
+        ring_size, size_t, batch_size
+    >;
+
+    structure_type structure;
+    std::atomic<bool> start(false);
+
+    // the producer alternates reserve/commit with single pushes
+    auto prod = std::async(
+        std::launch::async,
+        [&structure, &start] () {
+            while(!start);
+            size_t value = 1;
+            uint64_t want = 1;
+            while(value <= values_num)
+            {
+                auto span = structure.reserve(want);
+                uint64_t number = 0;
+                for(auto& ref : span)
+                {
+                    if(value > values_num) break;
+                    ref = value++;
+                    ++number;
+                }
+                structure.commit(number);
+                want = want % max_span + 1;
+                if(value <= values_num && structure.push(value)) ++value;
+                if(!number) std::this_thread::yield();
+            }
+            structure.flush();
+        }
+    );
+
+    // the consumer alternates peek/release with single pops
+    auto ts1 = std::chrono::high_resolution_clock::now();
+    start = true;
+    size_t expected = 1;
+    size_t sum = 0;
+    size_t peeked = 0;
+    bool ordered = true;
+    uint64_t want = max_span;
+    while(expected <= values_num)
+    {
+        auto span = structure.peek(want);
+        for(auto val : span)
+        {
+            ordered = ordered && val == expected;
+            ++expected;
+            sum += val;
+        }
+        peeked += span.size;
+        structure.release(span.size);
+        want = want % max_span + 1;
+        size_t val = 0;
+        if(structure.pop(val))
+        {
+            ordered = ordered && val == expected;
+            ++expected;
+            sum += val;
+        }
+        else if(!span.size) std::this_thread::yield();
+    }
+    prod.wait();
+    auto ts2 = std::chrono::high_resolution_clock::now();
+    auto msec = std::chrono::duration_cast<std::chrono::milliseconds>(
+        ts2 - ts1
+    ).count();
+
+    std::cout << "two_threads_queue, ring: " << ring_size
+        << ", batch: " << batch_size << std::endl;
+    std::cout << "  msec: " << msec << std::endl;
+    std::cout << "  popped: " << expected - 1 << std::endl;
+    std::cout << "  peeked: " << peeked << std::endl;
+    bool sum_ok = sum == values_num * (values_num + 1) / 2;
+    std::cout << "  order: " << (ordered ? "ok" : "wrong") << std::endl;
+    std::cout << "  sum: " << (sum_ok ? "ok" : "wrong") << std::endl;
+
+    return ordered && sum_ok ? 0 : 1;
+}
@@ -0,0 +1,22 @@
+#QMAKE_CXX = GCC7
+
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+CONFIG -= qt
+
+#QMAKE_CFLAGS += -static
+#QMAKE_CXXFLAGS += -static-libstdc++
+QMAKE_CXXFLAGS += -std=c++14 -Wall -Wextra -pedantic -O3 -pthread
+QMAKE_LFLAGS += -lpthread
+INCLUDEPATH += ./../../
+DESTDIR = build
+OBJECTS_DIR = build
+
+# no NDEBUG, the asserts of commit and release are part of the test
+
+HEADERS += ./../../technical.hpp \
+    ./../../other/queue.hpp
+
+SOURCES += main.cpp
+
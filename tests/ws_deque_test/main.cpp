@@ -0,0 +1,117 @@
+
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <future>
+#include <memory>
+#include <vector>
+
+#include <hp/ws_deque.hpp>
+
+
+
+namespace tools
+{
+    struct results_data
+    {
+        size_t success_thief = 0;
+        size_t fail_thief = 0;
+        size_t sum = 0;
+        std::future<void> fut;
+        char padding[128 - (3 * sizeof(size_t) + sizeof fut)];
+    };
+}
+
+
+int main(int /*argc*/, char** /*argv*/)
+{
+    using namespace tools;
+
+    constexpr size_t max_thieves_num = 4;
+    constexpr size_t values_num = 4000000;
+    // the owner pops one value per POP_PERIOD pushes, the rest is stolen
+    constexpr size_t POP_PERIOD = 4;
+    using structure_type = lock_free::hp::ws_deque<
+        max_thieves_num + 1, size_t
+    >;
+
+    for(size_t thieves_num = 1; thieves_num <= max_thieves_num; thieves_num *= 2)
+    {
+        // small to see the growth under the thieves
+        auto structure = std::make_unique<structure_type>(16);
+        results_data thief_arr[max_thieves_num];
+        std::atomic<bool> start(false);
+        std::atomic<bool> stop(false);
+        size_t owner_popped = 0;
+        size_t owner_sum = 0;
+
+        auto thief_func =
+            [&structure, &thief_arr, &start, &stop] (size_t i) mutable -> void
+            {
+                structure->thread_init();
+                auto& stat = thief_arr[i];
+                size_t value = 0;
+                while(!start);
+                while(true)
+                {
+                    if(structure->steal(value))
+                    {
+                        ++stat.success_thief;
+                        stat.sum += value;
+                        continue;
+                    }
+                    ++stat.fail_thief;
+                    if(stop) break;
+                }
+            };
+        for(size_t i = 0; i < thieves_num; ++i)
+            thief_arr[i].fut = std::async(std::launch::async, thief_func, i);
+
+        structure->thread_init();
+        auto ts1 = std::chrono::high_resolution_clock::now();
+        start = true;
+        size_t value = 0;
+        for(size_t i = 1; i <= values_num; ++i)
+        {
+            structure->push(i);
+            if(i % POP_PERIOD || !structure->pop(value)) continue;
+            ++owner_popped;
+            owner_sum += value;
+        }
+        while(structure->pop(value))
+        {
+            ++owner_popped;
+            owner_sum += value;
+        }
+        stop = true;
+        for(size_t i = 0; i < thieves_num; ++i) thief_arr[i].fut.wait();
+        auto ts2 = std::chrono::high_resolution_clock::now();
+        auto msec = std::chrono::duration_cast<std::chrono::milliseconds>(
+            ts2 - ts1
+        ).count();
+
+        size_t stolen = 0;
+        size_t failed = 0;
+        size_t sum = owner_sum;
+        for(size_t i = 0; i < thieves_num; ++i)
+        {
+            stolen += thief_arr[i].success_thief;
+            failed += thief_arr[i].fail_thief;
+            sum += thief_arr[i].sum;
+        }
+
+        // print statistics
+        std::cout << "owner: 1, thieves: " << thieves_num << std::endl;
+        std::cout << "  msec: " << msec << std::endl;
+        std::cout << "  owner_popped: " << owner_popped << std::endl;
+        std::cout << "  stolen: " << stolen << std::endl;
+        std::cout << "  fail_thief: " << failed << std::endl;
+        std::cout << "  steals/msec: " << (msec ? stolen / msec : 0) << std::endl;
+        std::cout << "  sum: "
+            << (sum == values_num * (values_num + 1) / 2 ? "ok" : "wrong")
+            << std::endl;
+    }
+
+    return 0;
+}
@@ -4,6 +4,7 @@
 #include <cstdint>
 
 #include <atomic>
+#include <chrono>
 #include <utility>
 #include <memory>
 #include <mutex>
@@ -26,7 +27,13 @@ template <
     uint64_t BucketsNumber,
     typename T,
     typename BackOff,
-    typename Allocator = std::allocator<T>,
+    typename Allocator = std::allocator<T>, // or slab_allocator<T>
+    typename Tptrs = tptrs, // wide_tptrs, index_tptrs
+    // or quiescent_trimming<1, Period, Watermark>, the policies are
+    // rebound to MaxThreadsNumber and BucketsNumber of the container
+    typename Trimming = no_trimming,
+    typename Statistics = no_pool_statistics, // or pool_statistics<>
+    typename Waiting = no_waiting, // or futex_waiting
     typename Tag = void
 > class queue: private boost::noncopyable
 {
@@ -41,12 +48,34 @@ public:
     static constexpr uint64_t INFINITE_NUMBER = -1;
 
     using value_type = T;
-    using node_type = node<T>;
+    using tptrs_type = Tptrs;
+    using tagged_type = typename tptrs_type::tagged_type;
+    using node_type = node<T, tptrs_type>;
     using allocator_type =
         typename Allocator:: template rebind<node_type>::other;
     using allocator_holder_type = allocator_holder<allocator_type>;
-    using free_nodes_type = queue_nodes_holder<node_type, BackOff>;
+    using free_nodes_type = queue_nodes_holder<
+        node_type, BackOff, tptrs_type
+    >;
     using backoff_strategy_type = BackOff;
+    using magazines_type = node_magazines<tptrs_type, MAX_THREADS_NUMBER>;
+    using trimming_type = typename Trimming::template rebind<
+        MAX_THREADS_NUMBER, BUCKETS_NUMBER
+    >::other;
+    using trimming_guard_type = trimming_guard<trimming_type>;
+    using statistics_type = typename Statistics::template rebind<
+        MAX_THREADS_NUMBER, BUCKETS_NUMBER
+    >::other;
+    using waiting_type = Waiting;
+
+    static_assert(
+        is_tptrs_allocator<tptrs_type, allocator_type>::value,
+        "index_tptrs need Allocator = index_tptrs<...>::allocator<T>"
+    );
+    static_assert(
+        !trimming_type::ENABLED || statistics_type::ENABLED,
+        "trimming needs the free nodes count of a statistics policy"
+    );
 
     struct bucket_type
     {
@@ -65,20 +94,29 @@ public:
 private:
     uint64_t get_thread_index()
     {
-        thread_local static uint64_t thread_index =
-            m_thread_index_calc.fetch_add(1, std::memory_order_acquire);
-        return thread_index;
+        return m_registry.get_thread_index();
     }
 
 public:
+    // the nodes numbers are per bucket; with a waiting policy a bucket
+    // may grow by its share of node_magazines::MAX_CACHED_NODES above
+    // max_nodes_number, so that push_wait reaches the limit
     queue(
         size_t init_nodes_number = 0,
         size_t max_nodes_number = INFINITE_NUMBER
     ):
-        m_thread_index_calc(0),
-        m_head(m_allocator_holder.allocate_and_construct()),
-        m_tail(m_head.load(std::memory_order_relaxed))
+        m_head(tptrs_type::set(
+            m_allocator_holder.allocate_and_construct(), 0
+        )),
+        m_tail(m_head.load(std::memory_order_relaxed)),
+        m_registry(
+            [this] (uint64_t i) { m_thread_data[i].bucket_index = i; },
+            [this] (uint64_t i) { release_magazines(i); }
+        )
     {
+        m_magazines.init(
+            std::max(init_nodes_number, max_nodes_number), BUCKETS_NUMBER
+        );
         for (uint64_t i = 0; i < BUCKETS_NUMBER; ++i)
         {
             auto& bucket = m_buckets[i];
@@ -90,85 +128,107 @@ public:
                 bucket.max_nodes_number = init_nodes_number;
             else
                 bucket.max_nodes_number = max_nodes_number;
+            // push_wait blocks at the limit, so with a waiting policy the
+            // nodes cached by the idle threads don't count against it
+            if(waiting_type::ENABLED)
+            {
+                bucket.max_nodes_number += std::min(
+                    m_magazines.get_cached_nodes_number(BUCKETS_NUMBER),
+                    INFINITE_NUMBER - bucket.max_nodes_number
+                );
+            }
             bucket.nodes_holder.init(
                 m_allocator_holder.allocate_and_construct()
             );
+            if (!init_nodes_number) continue;
+            // one slab per bucket, the holder hands the nodes out
+            // in address order
+            auto slab = m_allocator_holder.allocate_and_construct_slab(
+                init_nodes_number
+            );
+            m_slabs[i] = std::make_pair(slab, slab + init_nodes_number);
             for (uint64_t j = 0; j < init_nodes_number; ++j)
             {
-                bucket.nodes_holder.save_node(
-                    m_allocator_holder.allocate_and_construct()
-                );
+                bucket.nodes_holder.save_node(tptrs_type::set(slab + j, 0));
             }
+            m_statistics.add_free(0, i, init_nodes_number);
         }
         //
     }
-    ~queue() = default;
-    void thread_init()
-    {
-        if(m_thread_index_calc.load(std::memory_order_acquire) >=
-           MAX_THREADS_NUMBER
-        ) throw std::runtime_error("Too many threads");
-        get_thread_index();
-    }
-    void init()
+    // the trimmed nodes still waiting for the readers first, then
+    // every node in the queue, in the pools and in the magazines;
+    // the slab nodes go back with their slabs
+    ~queue()
     {
-        auto j = m_thread_index_calc.load(std::memory_order_relaxed);
-        for (uint64_t i = 0; i < j; ++i)
+        m_trimming.trim(
+            0,
+            [] (std::vector<void*>&) {},
+            [this] (void* ptr) { free_trimmed_node(0, ptr); },
+            true
+        );
+        free_nodes(tptrs_type::template get_pointer<node_type*>(
+            m_head.load(std::memory_order_acquire)
+        ));
+        for (auto& bucket : m_buckets)
+            free_nodes(bucket.nodes_holder.get_head());
+        std::vector<tagged_type> nodes;
+        for (uint64_t i = 0; i < MAX_THREADS_NUMBER; ++i)
+            m_magazines.flush(i, nodes);
+        m_magazines.take_depot(nodes);
+        for (auto ptr : nodes)
+        {
+            auto node_ptr = tptrs_type::template get_pointer<node_type*>(ptr);
+            if (!is_slab_node(node_ptr))
+                m_allocator_holder.destroy_and_deallocate(node_ptr);
+        }
+        for (auto& slab : m_slabs)
         {
-            m_thread_data[i].bucket_index = i;
+            if (!slab.first) continue;
+            m_allocator_holder.destroy_and_deallocate_slab(
+                slab.first, slab.second - slab.first
+            );
         }
     }
+    // optional, the slot is taken at the first call anyway
+    void thread_init()
+    {
+        get_thread_index();
+    }
+    // optional, kept for the two-phase initialization
+    void init() {}
 
     bool push(value_type const& value)
     {
-        uint64_t bucket_index =
-            m_thread_data[get_thread_index()].bucket_index++ % BUCKETS_NUMBER;
-        auto& bucket = m_buckets[bucket_index];
-        auto& nodes_holder = bucket.nodes_holder;
-
-        tagged_pointer new_node = nodes_holder.get_node(value);
-        if (!new_node)
-        {
-            if(bucket.current_nodes_number.fetch_add(
-                    1, std::memory_order_acq_rel
-               ) >= bucket.max_nodes_number
-            ) {
-                bucket.current_nodes_number.fetch_sub(
-                    1, std::memory_order_relaxed
-                );
-                return false;
-            }
-            try {
-                new_node = m_allocator_holder.allocate_and_construct(value);
-            } catch(...) {
-                bucket.current_nodes_number.fetch_sub(
-                    1, std::memory_order_seq_cst
-                );
-                throw;
-            }
-        }
-        tptrs::get_pointer<node_type*>(new_node)->next.store(
-            nullptr, std::memory_order_relaxed
-        );
+        uint64_t thread_index = get_thread_index();
+        trimming_guard_type guard(m_trimming, thread_index);
+        tagged_type new_node = get_free_node(thread_index, value);
+        if (tptrs_type::is_null(new_node)) return false;
+        tptrs_type::template get_pointer<node_type*>(new_node)->reset_next();
 
         while(true)
         {
             auto tail = m_tail.load(std::memory_order_consume);
-            auto tnext = tptrs::get_pointer<node_type*>(tail)->next.load(
+            auto tnext = tptrs_type::template get_pointer<node_type*>(
+                tail
+            )->next.load(
                 std::memory_order_consume
             );
             //if (tail != m_tail.load(std::memory_order_seq_cst)) continue;
 
-            if(!tnext)
+            if(tptrs_type::is_null(tnext))
             {
-                auto tail_ptr = tptrs::get_pointer<node_type*>(tail);
+                auto tail_ptr = tptrs_type::template get_pointer<node_type*>(
+                    tail
+                );
                 if(tail_ptr->next.compare_exchange_strong(
                     tnext,
-                    new_node,
+                    node_type::link(tnext, new_node),
                     std::memory_order_acq_rel
                 )) {
                     m_tail.compare_exchange_strong(
-                        tail, new_node, std::memory_order_release
+                        tail,
+                        node_type::link(tail, new_node),
+                        std::memory_order_release
                     );
                     break;
                 }
@@ -176,67 +236,516 @@ public:
             }
             else {
                 if(!m_tail.compare_exchange_strong(
-                    tail, tnext, std::memory_order_acq_rel
+                    tail,
+                    node_type::link(tail, tnext),
+                    std::memory_order_acq_rel
                 )) m_backoff.wait();
             }
             //
         }
+        m_not_empty.notify();
 
         return true;
     }
     bool pop(value_type& value)
     {
-        tagged_pointer head = nullptr;
+        uint64_t thread_index = get_thread_index();
+        trimming_guard_type guard(m_trimming, thread_index);
+        tagged_type head = tagged_type();
 
         while(true)
         {
             head = m_head.load(std::memory_order_consume);
             auto tail = m_tail.load(std::memory_order_consume);
-            auto hnext = tptrs::get_pointer<node_type*>(head)->next.load(
+            auto hnext = tptrs_type::template get_pointer<node_type*>(
+                head
+            )->next.load(
                 std::memory_order_consume
             );
-            //if(head != m_head.load(std::memory_order_seq_cst)) continue;
+            // head may have been popped and reused since, its next is
+            // then of another use and may be null
+            if(head != m_head.load(std::memory_order_acquire)) continue;
 
-            if(head == tail)
+            if(node_type::is_same(head, tail))
             {
-                if(!hnext) return false;
+                if(tptrs_type::is_null(hnext)) return false;
                 if(!m_tail.compare_exchange_strong(
-                    tail, hnext, std::memory_order_acq_rel
+                    tail,
+                    node_type::link(tail, hnext),
+                    std::memory_order_acq_rel
                 )) m_backoff.wait();
             }
             else {
-                value = tptrs::get_pointer<node_type*>(hnext)->value;
+                if(tptrs_type::is_null(hnext)) continue;
+                value = tptrs_type::template get_pointer<node_type*>(
+                    hnext
+                )->value;
                 if(m_head.compare_exchange_strong(
-                    head, hnext, std::memory_order_acq_rel
+                    head,
+                    node_type::link(head, hnext),
+                    std::memory_order_acq_rel
                 )) break;
                 m_backoff.wait();
             }
         }
 
+        save_free_node(thread_index, head);
+        m_not_full.notify();
+
+        return true;
+    }
+    // blocks until a value is popped, false if the timeout expired
+    bool pop_wait(
+        value_type& value,
+        std::chrono::nanoseconds timeout = std::chrono::nanoseconds::max()
+    ) {
+        static_assert(
+            waiting_type::ENABLED,
+            "pop_wait needs a waiting policy, e.g. futex_waiting"
+        );
+        return m_not_empty.wait_for(timeout, [&] { return pop(value); });
+    }
+    // blocks while the nodes limit is reached, false if the timeout expired
+    bool push_wait(
+        value_type const& value,
+        std::chrono::nanoseconds timeout = std::chrono::nanoseconds::max()
+    ) {
+        static_assert(
+            waiting_type::ENABLED,
+            "push_wait needs a waiting policy, e.g. futex_waiting"
+        );
+        return m_not_full.wait_for(timeout, [&] { return push(value); });
+    }
+
+    // the chain is linked privately and published with one CAS on
+    // tail->next; returns the number pushed, less than the range size
+    // if the nodes limit is reached
+    template <typename InputIterator>
+    uint64_t push_bulk(InputIterator first, InputIterator last)
+    {
+        uint64_t thread_index = get_thread_index();
+        trimming_guard_type guard(m_trimming, thread_index);
+        tagged_type chain_head = tagged_type();
+        tagged_type chain_tail = tagged_type();
+        uint64_t number = 0;
+        for (; first != last; ++first, ++number)
+        {
+            tagged_type new_node = get_free_node(thread_index, *first);
+            if (tptrs_type::is_null(new_node)) break;
+            tptrs_type::template get_pointer<node_type*>(new_node)->reset_next();
+            if (tptrs_type::is_null(chain_head)) chain_head = new_node;
+            else {
+                auto& next = tptrs_type::template get_pointer<node_type*>(
+                    chain_tail
+                )->next;
+                next.store(
+                    node_type::link(
+                        next.load(std::memory_order_relaxed), new_node
+                    ),
+                    std::memory_order_relaxed
+                );
+            }
+            chain_tail = new_node;
+        }
+        if (!number) return 0;
+
+        while(true)
+        {
+            auto tail = m_tail.load(std::memory_order_consume);
+            auto tnext = tptrs_type::template get_pointer<node_type*>(
+                tail
+            )->next.load(
+                std::memory_order_consume
+            );
+
+            if(tptrs_type::is_null(tnext))
+            {
+                auto tail_ptr = tptrs_type::template get_pointer<node_type*>(
+                    tail
+                );
+                if(tail_ptr->next.compare_exchange_strong(
+                    tnext,
+                    node_type::link(tnext, chain_head),
+                    std::memory_order_acq_rel
+                )) {
+                    m_tail.compare_exchange_strong(
+                        tail,
+                        node_type::link(tail, chain_tail),
+                        std::memory_order_release
+                    );
+                    break;
+                }
+                m_backoff.wait();
+            }
+            else {
+                if(!m_tail.compare_exchange_strong(
+                    tail,
+                    node_type::link(tail, tnext),
+                    std::memory_order_acq_rel
+                )) m_backoff.wait();
+            }
+        }
+        m_not_empty.notify(number);
+
+        return number;
+    }
+    // m_head is moved over up to number nodes with one CAS, but never
+    // past m_tail; returns the number of values written to out
+    uint64_t pop_bulk(value_type* out, uint64_t number)
+    {
+        if (!number) return 0;
+        uint64_t thread_index = get_thread_index();
+        trimming_guard_type guard(m_trimming, thread_index);
+        tagged_type head = tagged_type();
+        tagged_type new_head = tagged_type();
+        uint64_t popped = 0;
+
+        while(true)
+        {
+            head = m_head.load(std::memory_order_consume);
+            auto tail = m_tail.load(std::memory_order_consume);
+            auto hnext = tptrs_type::template get_pointer<node_type*>(
+                head
+            )->next.load(
+                std::memory_order_consume
+            );
+            if(head != m_head.load(std::memory_order_acquire)) continue;
+
+            if(node_type::is_same(head, tail))
+            {
+                if(tptrs_type::is_null(hnext)) return 0;
+                if(!m_tail.compare_exchange_strong(
+                    tail,
+                    node_type::link(tail, hnext),
+                    std::memory_order_acq_rel
+                )) m_backoff.wait();
+                continue;
+            }
+
+            // the nodes may be stale, the CAS on m_head validates them
+            popped = 0;
+            new_head = head;
+            while(popped < number && !node_type::is_same(new_head, tail))
+            {
+                auto next = tptrs_type::template get_pointer<node_type*>(
+                    new_head
+                )->next.load(std::memory_order_consume);
+                if(tptrs_type::is_null(next)) break;
+                out[popped++] = tptrs_type::template get_pointer<node_type*>(
+                    next
+                )->value;
+                new_head = next;
+            }
+            if(popped && m_head.compare_exchange_strong(
+                head,
+                node_type::link(head, new_head),
+                std::memory_order_acq_rel
+            )) break;
+            m_backoff.wait();
+        }
+
+        while(!node_type::is_same(head, new_head))
+        {
+            auto next = tptrs_type::template get_pointer<node_type*>(
+                head
+            )->next.load(std::memory_order_relaxed);
+            save_free_node(thread_index, head);
+            head = next;
+        }
+        m_not_full.notify(popped);
+
+        return popped;
+    }
+
+    // returns the surplus of the free nodes to the allocator, at most
+    // target nodes are kept per bucket besides the preallocated slab;
+    // the nodes a concurrent reader may see are freed by a later call
+    uint64_t trim(uint64_t target)
+    {
+        static_assert(
+            trimming_type::ENABLED,
+            "trim needs a trimming policy, e.g. quiescent_trimming"
+        );
+        return trim(get_thread_index(), target, true);
+    }
+
+    // the free nodes in the bucket holder, without the magazines
+    uint64_t get_nodes_count(uint64_t bucket_index) const
+    {
+        static_assert(
+            statistics_type::ENABLED,
+            "get_nodes_count needs a statistics policy"
+        );
+        return m_statistics.get_free_nodes(bucket_index);
+    }
+    // for sizing init_nodes_number and max_nodes_number from the load
+    typename statistics_type::snapshot_type get_statistics() const
+    {
+        static_assert(
+            statistics_type::ENABLED,
+            "get_statistics needs a statistics policy"
+        );
+        return m_statistics.snapshot();
+    }
+
+private:
+    // the magazine first, then the own bucket, then a new node within
+    // the bucket limit, then the nodes of the other buckets
+    tagged_type get_free_node(uint64_t thread_index, value_type const& value)
+    {
+        tagged_type new_node = m_magazines.get_node(thread_index);
+        if (!tptrs_type::is_null(new_node))
+        {
+            tptrs_type::template get_pointer<node_type*>(
+                new_node
+            )->value = value;
+            m_statistics.add(thread_index, statistics_type::MAGAZINE_HITS);
+            return new_node;
+        }
+
+        uint64_t retries = 0;
         uint64_t bucket_index =
-            m_thread_data[get_thread_index()].bucket_index++ % BUCKETS_NUMBER;
+            m_thread_data[thread_index].bucket_index++ % BUCKETS_NUMBER;
         auto& bucket = m_buckets[bucket_index];
-        bucket.nodes_holder.save_node(static_cast<node_type*>(head));
+        new_node = bucket.nodes_holder.get_node(value, &retries);
+        m_statistics.add(thread_index, statistics_type::GET_RETRIES, retries);
+        if (!tptrs_type::is_null(new_node))
+        {
+            m_statistics.add_free(thread_index, bucket_index, -1);
+            m_statistics.add(thread_index, statistics_type::BUCKET_HITS);
+            return new_node;
+        }
 
+        if(bucket.current_nodes_number.fetch_add(
+                1, std::memory_order_acq_rel
+           ) < bucket.max_nodes_number
+        ) {
+            try {
+                new_node = tptrs_type::set(
+                    m_allocator_holder.allocate_and_construct(value), 0
+                );
+                m_statistics.add(
+                    thread_index, statistics_type::ALLOCATIONS
+                );
+                return new_node;
+            } catch(...) {
+                bucket.current_nodes_number.fetch_sub(
+                    1, std::memory_order_seq_cst
+                );
+                throw;
+            }
+        }
+        bucket.current_nodes_number.fetch_sub(1, std::memory_order_relaxed);
+        m_statistics.add(thread_index, statistics_type::REJECTIONS);
+        // a full magazine of the depot is the last reachable one
+        if (save_depot_magazine(thread_index, bucket_index))
+        {
+            new_node = bucket.nodes_holder.get_node(value, &retries);
+            if (!tptrs_type::is_null(new_node))
+            {
+                m_statistics.add_free(thread_index, bucket_index, -1);
+                m_statistics.add(thread_index, statistics_type::BUCKET_HITS);
+                return new_node;
+            }
+        }
+        for (uint64_t i = 1; i < BUCKETS_NUMBER; ++i)
+        {
+            uint64_t steal_index = (bucket_index + i) % BUCKETS_NUMBER;
+            retries = 0;
+            new_node = m_buckets[steal_index].nodes_holder.get_node(
+                value, &retries
+            );
+            m_statistics.add(
+                thread_index, statistics_type::GET_RETRIES, retries
+            );
+            if (!tptrs_type::is_null(new_node))
+            {
+                m_statistics.add_free(thread_index, steal_index, -1);
+                m_statistics.add(thread_index, statistics_type::STEALS);
+                break;
+            }
+        }
+        return new_node;
+    }
+    void save_free_node(uint64_t thread_index, tagged_type ptr)
+    {
+        if(!m_magazines.save_node(thread_index, ptr))
+        {
+            uint64_t retries = 0;
+            uint64_t bucket_index =
+                m_thread_data[thread_index].bucket_index++ % BUCKETS_NUMBER;
+            m_buckets[bucket_index].nodes_holder.save_node(ptr, &retries);
+            m_statistics.add_free(thread_index, bucket_index, 1);
+            m_statistics.add(
+                thread_index, statistics_type::SAVE_RETRIES, retries
+            );
+        }
+        if(m_trimming.need_trim(thread_index))
+            trim(thread_index, trimming_type::WATERMARK, false);
+    }
+    void save_free_nodes(
+        uint64_t thread_index,
+        uint64_t bucket_index,
+        tagged_type const* nodes,
+        uint64_t number
+    )
+    {
+        for (auto ptr = nodes; ptr != nodes + number; ++ptr)
+        {
+            uint64_t retries = 0;
+            m_buckets[bucket_index].nodes_holder.save_node(*ptr, &retries);
+            m_statistics.add(
+                thread_index, statistics_type::SAVE_RETRIES, retries
+            );
+        }
+        m_statistics.add_free(thread_index, bucket_index, number);
+    }
+    // the whole depot under its lock, not for the operations
+    void save_depot(uint64_t thread_index, uint64_t bucket_index)
+    {
+        std::vector<tagged_type> nodes;
+        m_magazines.take_depot(nodes);
+        save_free_nodes(thread_index, bucket_index, nodes.data(), nodes.size());
+    }
+    // one full magazine of the depot if its lock is free,
+    // false otherwise or if the depot was empty
+    bool save_depot_magazine(uint64_t thread_index, uint64_t bucket_index)
+    {
+        typename magazines_type::magazine_type magazine;
+        if (!m_magazines.take_magazine(magazine)) return false;
+        save_free_nodes(
+            thread_index, bucket_index, magazine.nodes.data(), magazine.size
+        );
         return true;
     }
+    // by the exiting thread, nobody else could take its nodes
+    void release_magazines(uint64_t thread_index)
+    {
+        trimming_guard_type guard(m_trimming, thread_index);
+        std::vector<tagged_type> nodes;
+        m_magazines.flush(thread_index, nodes);
+        save_free_nodes(
+            thread_index,
+            m_thread_data[thread_index].bucket_index % BUCKETS_NUMBER,
+            nodes.data(),
+            nodes.size()
+        );
+    }
 
-    uint64_t get_nodes_count(uint64_t bucket_index) const
+    uint64_t trim(uint64_t thread_index, uint64_t target, bool wait)
     {
-        return m_buckets[bucket_index].nodes_holder.get_nodes_count();
+        trimming_guard_type guard(m_trimming, thread_index);
+        return m_trimming.trim(
+            thread_index,
+            [this, thread_index, target] (std::vector<void*>& nodes) {
+                detach_surplus(thread_index, target, nodes);
+            },
+            [this, thread_index] (void* ptr) {
+                free_trimmed_node(thread_index, ptr);
+            },
+            wait
+        );
+    }
+    // only the surplus above target is popped from a bucket by the
+    // lock-free get_node, so the bucket never looks empty meanwhile;
+    // the slab nodes met on the way are saved back. The depot is
+    // counted in first, the nodes in the magazines are never trimmed
+    void detach_surplus(
+        uint64_t thread_index,
+        uint64_t target,
+        std::vector<void*>& nodes
+    )
+    {
+        save_depot(
+            thread_index,
+            m_thread_data[thread_index].bucket_index % BUCKETS_NUMBER
+        );
+        std::vector<tagged_type> slab_nodes;
+        for (uint64_t i = 0; i < BUCKETS_NUMBER; ++i)
+        {
+            // the sum of the deltas may be transiently negative
+            auto count =
+                static_cast<int64_t>(m_statistics.get_free_nodes(i));
+            uint64_t kept_number = m_slabs[i].second - m_slabs[i].first;
+            kept_number += std::min(target, INFINITE_NUMBER - kept_number);
+            if (count <= 0 || static_cast<uint64_t>(count) <= kept_number)
+                continue;
+
+            // the slab nodes are popped once at most, so the work is
+            // bounded by the surplus and the slab size
+            auto& nodes_holder = m_buckets[i].nodes_holder;
+            uint64_t surplus = count - kept_number;
+            for (uint64_t j = count; surplus && j; --j)
+            {
+                tagged_type ptr = nodes_holder.get_node();
+                if (tptrs_type::is_null(ptr)) break;
+                auto node_ptr =
+                    tptrs_type::template get_pointer<node_type*>(ptr);
+                if (is_slab_node(node_ptr)) slab_nodes.push_back(ptr);
+                else {
+                    m_statistics.add_free(thread_index, i, -1);
+                    nodes.push_back(node_ptr);
+                    --surplus;
+                }
+            }
+            for (auto ptr : slab_nodes) nodes_holder.save_node(ptr);
+            slab_nodes.clear();
+        }
+    }
+    // the nodes linked from ptr up to a null next
+    void free_nodes(node_type* ptr)
+    {
+        while (ptr)
+        {
+            auto next = tptrs_type::template get_pointer<node_type*>(
+                ptr->next.load(std::memory_order_relaxed)
+            );
+            if (!is_slab_node(ptr))
+                m_allocator_holder.destroy_and_deallocate(ptr);
+            ptr = next;
+        }
+    }
+    bool is_slab_node(node_type* ptr) const
+    {
+        for (auto& slab : m_slabs)
+        {
+            if (ptr >= slab.first && ptr < slab.second) return true;
+        }
+        return false;
+    }
+    // the nodes limit is shared, any bucket gives its count back
+    void free_trimmed_node(uint64_t thread_index, void* ptr)
+    {
+        m_statistics.add(thread_index, statistics_type::TRIMMED);
+        m_allocator_holder.destroy_and_deallocate(static_cast<node_type*>(ptr));
+        for (auto& bucket : m_buckets)
+        {
+            auto& nodes_number = bucket.current_nodes_number;
+            auto number = nodes_number.load(std::memory_order_relaxed);
+            while (number && !nodes_number.compare_exchange_weak(
+                number, number - 1, std::memory_order_relaxed
+            ));
+            if (number) break;
+        }
     }
 
 private:
-    std::atomic<uint64_t> m_thread_index_calc;
     std::array<bucket_type, BUCKETS_NUMBER> m_buckets;
     std::array<perthread_data_type, MAX_THREADS_NUMBER> m_thread_data;
     allocator_holder_type m_allocator_holder;
     char padding1[128 - sizeof m_allocator_holder];
-    std::atomic<tagged_pointer> m_head;
+    typename tptrs_type::atomic_type m_head;
     char padding2[128 - sizeof m_head];
-    std::atomic<tagged_pointer> m_tail;
+    typename tptrs_type::atomic_type m_tail;
     char padding3[128 - sizeof m_tail];
     backoff_strategy_type m_backoff;
+    magazines_type m_magazines;
+    trimming_type m_trimming;
+    statistics_type m_statistics;
+    waiting_type m_not_empty;
+    waiting_type m_not_full;
+    std::array<std::pair<node_type*, node_type*>, BUCKETS_NUMBER> m_slabs{};
+    thread_registry<MAX_THREADS_NUMBER> m_registry;
 };
     //
 }
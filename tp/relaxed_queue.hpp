@@ -0,0 +1,391 @@
+#ifndef __TAGGED_POINTERS_RELAXED_QUEUE_HPP__
+#define __TAGGED_POINTERS_RELAXED_QUEUE_HPP__
+
+#include <cstdint>
+
+#include <atomic>
+#include <array>
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include <boost/noncopyable.hpp>
+
+#include "../technical.hpp"
+
+
+
+namespace lock_free
+{
+namespace tp
+{
+    // relaxed FIFO over LanesNumber Michael-Scott lanes: a thread pushes
+    // to its home lane, a pop takes the older of the heads of two random
+    // lanes and scans all lanes if both look empty; FIFO holds per lane,
+    // across the lanes the order is approximate
+    template <
+        uint64_t MaxThreadsNumber,
+        uint64_t LanesNumber,
+        typename T,
+        typename BackOff,
+        typename Allocator = std::allocator<T>, // or slab_allocator<T>
+        typename Tptrs = tptrs, // wide_tptrs, index_tptrs
+        typename Tag = void
+    > class relaxed_queue: private boost::noncopyable
+    {
+    public:
+        static_assert(
+            std::is_trivially_copyable<T>::value,
+            "T must be trivially copyable"
+        );
+        static_assert(LanesNumber >= 1, "at least one lane is needed");
+
+        static constexpr uint64_t MAX_THREADS_NUMBER = MaxThreadsNumber;
+        static constexpr uint64_t LANES_NUMBER = LanesNumber;
+        static constexpr uint64_t INFINITE_NUMBER = -1;
+        static constexpr uint64_t EMPTY_STAMP =
+            std::numeric_limits<uint64_t>::max();
+
+        using value_type = T;
+        // the push time orders the heads of the lanes
+        struct stamped_type
+        {
+            value_type value;
+            uint64_t stamp;
+        };
+        using tptrs_type = Tptrs;
+        using tagged_type = typename tptrs_type::tagged_type;
+        using atomic_type = typename tptrs_type::atomic_type;
+        using node_type = node<stamped_type, tptrs_type>;
+        using allocator_type =
+            typename Allocator:: template rebind<node_type>::other;
+        using allocator_holder_type = allocator_holder<allocator_type>;
+        using free_nodes_type = queue_nodes_holder<
+            node_type, BackOff, tptrs_type
+        >;
+        using backoff_strategy_type = BackOff;
+
+        static_assert(
+            is_tptrs_allocator<tptrs_type, allocator_type>::value,
+            "index_tptrs need Allocator = index_tptrs<...>::allocator<T>"
+        );
+
+        struct lane_type
+        {
+            lane_type(): current_nodes_number(0) {}
+
+            atomic_type head;
+            char padding1[128 - sizeof head];
+            atomic_type tail;
+            char padding2[128 - sizeof tail];
+            std::atomic<uint64_t> current_nodes_number;
+            uint64_t max_nodes_number = 0;
+            free_nodes_type nodes_holder;
+        };
+        struct perthread_data_type
+        {
+            uint64_t home_lane = 0;
+            uint64_t random = 1;
+            char padding[128 - 2 * sizeof(uint64_t)];
+        };
+
+    private:
+        uint64_t get_thread_index()
+        {
+            return m_registry.get_thread_index();
+        }
+
+    public:
+        // the nodes numbers are per lane
+        relaxed_queue(
+            size_t init_nodes_number = 0,
+            size_t max_nodes_number = INFINITE_NUMBER
+        ):
+            m_registry(
+                [this] (uint64_t i) {
+                    m_thread_data[i].home_lane = i % LANES_NUMBER;
+                    m_thread_data[i].random = (i + 1) * 0x9e3779b97f4a7c15;
+                }
+            )
+        {
+            for (uint64_t i = 0; i < LANES_NUMBER; ++i)
+            {
+                auto& lane = m_lanes[i];
+                auto dummy = tptrs_type::set(
+                    m_allocator_holder.allocate_and_construct(), 0
+                );
+                lane.head.store(dummy, std::memory_order_relaxed);
+                lane.tail.store(dummy, std::memory_order_relaxed);
+                lane.current_nodes_number.store(
+                    init_nodes_number,
+                    std::memory_order_relaxed
+                );
+                if(max_nodes_number < init_nodes_number)
+                    lane.max_nodes_number = init_nodes_number;
+                else
+                    lane.max_nodes_number = max_nodes_number;
+                lane.nodes_holder.init(
+                    m_allocator_holder.allocate_and_construct()
+                );
+                if (!init_nodes_number) continue;
+                auto slab = m_allocator_holder.allocate_and_construct_slab(
+                    init_nodes_number
+                );
+                m_slabs[i] = std::make_pair(slab, slab + init_nodes_number);
+                for (uint64_t j = 0; j < init_nodes_number; ++j)
+                {
+                    lane.nodes_holder.save_node(tptrs_type::set(slab + j, 0));
+                }
+            }
+        }
+        // every node is either queued in a lane or free in a lane pool,
+        // the slab nodes go back with their slabs
+        ~relaxed_queue()
+        {
+            for (auto& lane : m_lanes)
+            {
+                free_nodes(tptrs_type::template get_pointer<node_type*>(
+                    lane.head.load(std::memory_order_acquire)
+                ));
+                free_nodes(lane.nodes_holder.get_head());
+            }
+            for (auto& slab : m_slabs)
+            {
+                if (!slab.first) continue;
+                m_allocator_holder.destroy_and_deallocate_slab(
+                    slab.first, slab.second - slab.first
+                );
+            }
+        }
+        // optional, the slot is taken at the first call anyway
+        void thread_init()
+        {
+            get_thread_index();
+        }
+        // optional, kept for the two-phase initialization
+        void init() {}
+
+        // false if the nodes limit is reached
+        bool push(value_type const& value)
+        {
+            auto& data = m_thread_data[get_thread_index()];
+            auto& lane = m_lanes[data.home_lane];
+            tagged_type new_node = get_free_node(data.home_lane, value);
+            if (tptrs_type::is_null(new_node)) return false;
+
+            while(true)
+            {
+                auto tail = lane.tail.load(std::memory_order_consume);
+                auto tnext = tptrs_type::template get_pointer<node_type*>(
+                    tail
+                )->next.load(
+                    std::memory_order_consume
+                );
+
+                if(tptrs_type::is_null(tnext))
+                {
+                    auto tail_ptr =
+                        tptrs_type::template get_pointer<node_type*>(tail);
+                    if(tail_ptr->next.compare_exchange_strong(
+                        tnext,
+                        node_type::link(tnext, new_node),
+                        std::memory_order_acq_rel
+                    )) {
+                        lane.tail.compare_exchange_strong(
+                            tail,
+                            node_type::link(tail, new_node),
+                            std::memory_order_release
+                        );
+                        return true;
+                    }
+                    m_backoff.wait();
+                }
+                else {
+                    if(!lane.tail.compare_exchange_strong(
+                        tail,
+                        node_type::link(tail, tnext),
+                        std::memory_order_acq_rel
+                    )) m_backoff.wait();
+                }
+            }
+        }
+        // false if no lane had a value during the scan, which is not
+        // a snapshot of the whole queue
+        bool pop(value_type& value)
+        {
+            auto& data = m_thread_data[get_thread_index()];
+            if (LANES_NUMBER > 1)
+            {
+                uint64_t first = get_random(data) % LANES_NUMBER;
+                uint64_t second = get_random(data) % LANES_NUMBER;
+                auto first_stamp = get_head_stamp(first);
+                auto second_stamp = get_head_stamp(second);
+                if (second_stamp < first_stamp)
+                {
+                    std::swap(first, second);
+                    std::swap(first_stamp, second_stamp);
+                }
+                if (first_stamp != EMPTY_STAMP && pop_lane(first, value))
+                    return true;
+            }
+            uint64_t start = get_random(data) % LANES_NUMBER;
+            for (uint64_t i = 0; i < LANES_NUMBER; ++i)
+            {
+                if (pop_lane((start + i) % LANES_NUMBER, value)) return true;
+            }
+            return false;
+        }
+
+    private:
+        static uint64_t get_stamp()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()
+            ).count();
+        }
+        static uint64_t get_random(perthread_data_type& data)
+        {
+            auto& state = data.random;
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            return state;
+        }
+        // a racy peek, the nodes are never freed while the queue lives
+        uint64_t get_head_stamp(uint64_t lane_index) const
+        {
+            auto head = m_lanes[lane_index].head.load(
+                std::memory_order_acquire
+            );
+            auto hnext = tptrs_type::template get_pointer<node_type*>(
+                head
+            )->next.load(std::memory_order_acquire);
+            if (tptrs_type::is_null(hnext)) return EMPTY_STAMP;
+            return tptrs_type::template get_pointer<node_type*>(
+                hnext
+            )->value.stamp;
+        }
+
+        bool pop_lane(uint64_t lane_index, value_type& value)
+        {
+            auto& lane = m_lanes[lane_index];
+            tagged_type head = tagged_type();
+            while(true)
+            {
+                head = lane.head.load(std::memory_order_consume);
+                auto tail = lane.tail.load(std::memory_order_consume);
+                auto hnext = tptrs_type::template get_pointer<node_type*>(
+                    head
+                )->next.load(
+                    std::memory_order_consume
+                );
+                // as in tp::queue::pop, a stale head may have a null next
+                if(head != lane.head.load(std::memory_order_acquire)) continue;
+
+                if(node_type::is_same(head, tail))
+                {
+                    if(tptrs_type::is_null(hnext)) return false;
+                    if(!lane.tail.compare_exchange_strong(
+                        tail,
+                        node_type::link(tail, hnext),
+                        std::memory_order_acq_rel
+                    )) m_backoff.wait();
+                }
+                else {
+                    if(tptrs_type::is_null(hnext)) continue;
+                    value = tptrs_type::template get_pointer<node_type*>(
+                        hnext
+                    )->value.value;
+                    if(lane.head.compare_exchange_strong(
+                        head,
+                        node_type::link(head, hnext),
+                        std::memory_order_acq_rel
+                    )) break;
+                    m_backoff.wait();
+                }
+            }
+            // the dummy node goes back to the pool of the lane it left
+            lane.nodes_holder.save_node(head);
+
+            return true;
+        }
+
+        // the own lane pool, then a new node within the lane limit,
+        // then the pools of the other lanes
+        tagged_type get_free_node(uint64_t lane_index, value_type const& value)
+        {
+            stamped_type stamped{value, get_stamp()};
+            auto& lane = m_lanes[lane_index];
+            tagged_type new_node = lane.nodes_holder.get_node(stamped);
+            if (!tptrs_type::is_null(new_node)) return reset(new_node);
+
+            if(lane.current_nodes_number.fetch_add(
+                    1, std::memory_order_acq_rel
+               ) < lane.max_nodes_number
+            ) {
+                try {
+                    return tptrs_type::set(
+                        m_allocator_holder.allocate_and_construct(stamped), 0
+                    );
+                } catch(...) {
+                    lane.current_nodes_number.fetch_sub(
+                        1, std::memory_order_seq_cst
+                    );
+                    throw;
+                }
+            }
+            lane.current_nodes_number.fetch_sub(1, std::memory_order_relaxed);
+            for (uint64_t i = 1; i < LANES_NUMBER; ++i)
+            {
+                new_node = m_lanes[
+                    (lane_index + i) % LANES_NUMBER
+                ].nodes_holder.get_node(stamped);
+                if (!tptrs_type::is_null(new_node)) return reset(new_node);
+            }
+            return new_node;
+        }
+        static tagged_type reset(tagged_type ptr)
+        {
+            tptrs_type::template get_pointer<node_type*>(ptr)->reset_next();
+            return ptr;
+        }
+
+        // the nodes linked from ptr up to a null next
+        void free_nodes(node_type* ptr)
+        {
+            while (ptr)
+            {
+                auto next = tptrs_type::template get_pointer<node_type*>(
+                    ptr->next.load(std::memory_order_relaxed)
+                );
+                if (!is_slab_node(ptr))
+                    m_allocator_holder.destroy_and_deallocate(ptr);
+                ptr = next;
+            }
+        }
+        bool is_slab_node(node_type* ptr) const
+        {
+            for (auto& slab : m_slabs)
+            {
+                if (ptr >= slab.first && ptr < slab.second) return true;
+            }
+            return false;
+        }
+
+    private:
+        std::array<lane_type, LANES_NUMBER> m_lanes;
+        std::array<perthread_data_type, MAX_THREADS_NUMBER> m_thread_data;
+        allocator_holder_type m_allocator_holder;
+        char padding1[128 - sizeof m_allocator_holder];
+        backoff_strategy_type m_backoff;
+        std::array<std::pair<node_type*, node_type*>, LANES_NUMBER> m_slabs{};
+        thread_registry<MAX_THREADS_NUMBER> m_registry;
+    };
+    //
+}
+}
+
+#endif // __TAGGED_POINTERS_RELAXED_QUEUE_HPP__
@@ -26,7 +26,13 @@ namespace tp
         uint64_t BucketsNumber,
         typename T,
         typename BackOff,
-        typename Allocator = std::allocator<T>,
+        typename Allocator = std::allocator<T>, // or slab_allocator<T>
+        typename Tptrs = tptrs, // wide_tptrs, index_tptrs
+        typename Elimination = no_elimination, // or elimination_array<T>
+        // or quiescent_trimming<1, Period, Watermark>, the policies are
+        // rebound to MaxThreadsNumber and BucketsNumber of the container
+        typename Trimming = no_trimming,
+        typename Statistics = no_pool_statistics, // or pool_statistics<>
         typename Tag = void
     > class stack: private boost::noncopyable
     {
@@ -41,12 +47,34 @@ namespace tp
         static constexpr uint64_t INFINITE_NUMBER = -1;
 
         using value_type = T;
-        using node_type = node<T>;
+        using tptrs_type = Tptrs;
+        using tagged_type = typename tptrs_type::tagged_type;
+        using node_type = node<T, tptrs_type>;
         using allocator_type =
             typename Allocator:: template rebind<node_type>::other;
         using allocator_holder_type = allocator_holder<allocator_type>;
-        using free_nodes_type = stack_nodes_holder<node_type, BackOff>;
+        using free_nodes_type = stack_nodes_holder<
+            node_type, BackOff, tptrs_type
+        >;
         using backoff_strategy_type = BackOff;
+        using elimination_type = Elimination;
+        using magazines_type = node_magazines<tptrs_type, MAX_THREADS_NUMBER>;
+        using trimming_type = typename Trimming::template rebind<
+            MAX_THREADS_NUMBER, BUCKETS_NUMBER
+        >::other;
+        using trimming_guard_type = trimming_guard<trimming_type>;
+        using statistics_type = typename Statistics::template rebind<
+            MAX_THREADS_NUMBER, BUCKETS_NUMBER
+        >::other;
+
+        static_assert(
+            is_tptrs_allocator<tptrs_type, allocator_type>::value,
+            "index_tptrs need Allocator = index_tptrs<...>::allocator<T>"
+        );
+        static_assert(
+            !trimming_type::ENABLED || statistics_type::ENABLED,
+            "trimming needs the free nodes count of a statistics policy"
+        );
 
         struct bucket_type
         {
@@ -64,9 +92,7 @@ namespace tp
     private:
         uint64_t get_thread_index()
         {
-            thread_local static uint64_t thread_index =
-                m_thread_index_calc.fetch_add(1, std::memory_order_acquire);
-            return thread_index;
+            return m_registry.get_thread_index();
         }
 
     public:
@@ -74,9 +100,17 @@ namespace tp
             size_t init_nodes_number = 0,
             size_t max_nodes_number = INFINITE_NUMBER
         ):
-            m_thread_index_calc(0),
-            m_head(m_allocator_holder.allocate_and_construct())
+            m_head(tptrs_type::set(
+                m_allocator_holder.allocate_and_construct(), 0
+            )),
+            m_registry(
+                [this] (uint64_t i) { m_thread_data[i].bucket_index = i; },
+                [this] (uint64_t i) { release_magazines(i); }
+            )
         {
+            m_magazines.init(
+                std::max(init_nodes_number, max_nodes_number), BUCKETS_NUMBER
+            );
             for (uint64_t i = 0; i < BUCKETS_NUMBER; ++i)
             {
                 auto& bucket = m_buckets[i];
@@ -91,64 +125,79 @@ namespace tp
                 bucket.nodes_holder.init(
                     m_allocator_holder.allocate_and_construct()
                 );
-                for (uint64_t j = 0; j < init_nodes_number; ++j)
+                if (!init_nodes_number) continue;
+                // one slab per bucket, saved backwards so that the holder
+                // hands the nodes out in address order
+                auto slab = m_allocator_holder.allocate_and_construct_slab(
+                    init_nodes_number
+                );
+                m_slabs[i] = std::make_pair(slab, slab + init_nodes_number);
+                for (uint64_t j = init_nodes_number; j > 0; --j)
                 {
                     bucket.nodes_holder.save_node(
-                        m_allocator_holder.allocate_and_construct()
+                        tptrs_type::set(slab + j - 1, 0)
                     );
                 }
+                m_statistics.add_free(0, i, init_nodes_number);
             }
         }
-        ~stack() = default;
-        void thread_init()
+        // the trimmed nodes still waiting for the readers first, then
+        // every node in the stack, in the pools and in the magazines;
+        // the slab nodes go back with their slabs
+        ~stack()
         {
-            if(m_thread_index_calc.load(std::memory_order_acquire) >=
-               MAX_THREADS_NUMBER
-            ) throw std::runtime_error("Too many threads");
-            get_thread_index();
-        }
-        void init()
-        {
-            auto j = m_thread_index_calc.load(std::memory_order_relaxed);
-            for (uint64_t i = 0; i < j; ++i)
+            m_trimming.trim(
+                0,
+                [] (std::vector<void*>&) {},
+                [this] (void* ptr) { free_trimmed_node(0, ptr); },
+                true
+            );
+            free_nodes(tptrs_type::template get_pointer<node_type*>(
+                m_head.load(std::memory_order_acquire), true
+            ));
+            for (auto& bucket : m_buckets)
+                free_nodes(bucket.nodes_holder.get_head());
+            std::vector<tagged_type> nodes;
+            for (uint64_t i = 0; i < MAX_THREADS_NUMBER; ++i)
+                m_magazines.flush(i, nodes);
+            m_magazines.take_depot(nodes);
+            for (auto ptr : nodes)
+            {
+                auto node_ptr =
+                    tptrs_type::template get_pointer<node_type*>(ptr);
+                if (!is_slab_node(node_ptr))
+                    m_allocator_holder.destroy_and_deallocate(node_ptr);
+            }
+            for (auto& slab : m_slabs)
             {
-                m_thread_data[i].bucket_index = i;
+                if (!slab.first) continue;
+                m_allocator_holder.destroy_and_deallocate_slab(
+                    slab.first, slab.second - slab.first
+                );
             }
         }
+        // optional, the slot is taken at the first call anyway
+        void thread_init()
+        {
+            get_thread_index();
+        }
+        // optional, kept for the two-phase initialization
+        void init() {}
 
         bool push(value_type const& value)
         {
-            uint64_t bucket_index =
-                m_thread_data[get_thread_index()].bucket_index++ % BUCKETS_NUMBER;
-            auto& bucket = m_buckets[bucket_index];
-            auto& nodes_holder = bucket.nodes_holder;
+            uint64_t thread_index = get_thread_index();
+            trimming_guard_type guard(m_trimming, thread_index);
+            tagged_type new_node = get_free_node(thread_index, value);
+            if (tptrs_type::is_null(new_node)) return false;
 
-            tagged_pointer new_node = nodes_holder.get_node(value);
-            if (!new_node)
-            {
-                if(bucket.current_nodes_number.fetch_add(
-                        1, std::memory_order_acq_rel
-                   ) >= bucket.max_nodes_number
-                ) {
-                    bucket.current_nodes_number.fetch_sub(
-                        1, std::memory_order_relaxed
-                    );
-                    return false;
-                }
-                try {
-                    new_node = m_allocator_holder.allocate_and_construct(value);
-                } catch(...) {
-                    bucket.current_nodes_number.fetch_sub(
-                        1, std::memory_order_seq_cst
-                    );
-                    throw;
-                }
-            }
-            tagged_pointer current_head = m_head.load(std::memory_order_consume);
+            tagged_type current_head = m_head.load(std::memory_order_consume);
 
             while(true)
             {
-                tptrs::get_pointer<node_type*>(new_node)->next.store(
+                tptrs_type::template get_pointer<node_type*>(
+                    new_node
+                )->next.store(
                     current_head, std::memory_order_relaxed
                 );
                 // ABA+
@@ -156,50 +205,418 @@ namespace tp
                           current_head, new_node, std::memory_order_acq_rel
                     )
                 ) return true;
+                if(m_elimination.try_push(value))
+                {
+                    save_free_node(thread_index, new_node);
+                    return true;
+                }
                 m_backoff.wait();
             }
         }
         bool pop(value_type& value)
         {
+            uint64_t thread_index = get_thread_index();
+            trimming_guard_type guard(m_trimming, thread_index);
             auto current_head = m_head.load(std::memory_order_relaxed);
             while(true)
             {
                 auto next_head =
-                    tptrs::get_pointer<node_type*>(current_head)->next.load(
+                    tptrs_type::template get_pointer<node_type*>(
+                        current_head
+                    )->next.load(
                         std::memory_order_relaxed
                     );
-                if (!next_head) return false;
-                value = tptrs::get_pointer<node_type*>(current_head)->value;
+                if (tptrs_type::is_null(next_head)) return false;
+                value = tptrs_type::template get_pointer<node_type*>(
+                    current_head
+                )->value;
                 if(m_head.compare_exchange_strong(
                         current_head, next_head, std::memory_order_acq_rel
                    )
                 ) break;
+                if(m_elimination.try_pop(value)) return true;
                 m_backoff.wait();
             }
 
+            save_free_node(thread_index, current_head);
+
+            return true;
+        }
+
+        // the chain is linked privately and published with one CAS,
+        // the last value ends up on the top; returns the number pushed,
+        // less than the range size if the nodes limit is reached
+        template <typename InputIterator>
+        uint64_t push_range(InputIterator first, InputIterator last)
+        {
+            uint64_t thread_index = get_thread_index();
+            trimming_guard_type guard(m_trimming, thread_index);
+            tagged_type top = tagged_type();
+            tagged_type bottom = tagged_type();
+            uint64_t number = 0;
+            for (; first != last; ++first, ++number)
+            {
+                tagged_type new_node = get_free_node(thread_index, *first);
+                if (tptrs_type::is_null(new_node)) break;
+                tptrs_type::template get_pointer<node_type*>(
+                    new_node
+                )->next.store(top, std::memory_order_relaxed);
+                if (tptrs_type::is_null(top)) bottom = new_node;
+                top = new_node;
+            }
+            if (!number) return 0;
+
+            tagged_type current_head = m_head.load(std::memory_order_consume);
+            while(true)
+            {
+                tptrs_type::template get_pointer<node_type*>(
+                    bottom
+                )->next.store(
+                    current_head, std::memory_order_relaxed
+                );
+                if (m_head.compare_exchange_strong(
+                          current_head, top, std::memory_order_acq_rel
+                    )
+                ) return number;
+                m_backoff.wait();
+            }
+        }
+        // the whole chain is detached by swapping in a new bottom node,
+        // the values go out from the top; returns the number popped
+        template <typename OutputIterator>
+        uint64_t pop_all(OutputIterator out)
+        {
+            uint64_t thread_index = get_thread_index();
+            trimming_guard_type guard(m_trimming, thread_index);
+            uint64_t number = 0;
+            tagged_type bottom = get_free_node(thread_index, value_type());
+            // the nodes limit is reached, drain one by one
+            if (tptrs_type::is_null(bottom))
+            {
+                value_type value;
+                for (; pop(value); ++number) *out++ = value;
+                return number;
+            }
+            tptrs_type::template get_pointer<node_type*>(bottom)->next.store(
+                tagged_type(), std::memory_order_relaxed
+            );
+
+            tagged_type head = m_head.load(std::memory_order_relaxed);
+            while(!m_head.compare_exchange_weak(
+                head, bottom, std::memory_order_acq_rel
+            ));
+
+            while(true)
+            {
+                auto head_ptr =
+                    tptrs_type::template get_pointer<node_type*>(head);
+                auto next = head_ptr->next.load(std::memory_order_relaxed);
+                if (tptrs_type::is_null(next)) break;
+                *out++ = head_ptr->value;
+                ++number;
+                save_free_node(thread_index, head);
+                head = next;
+            }
+            save_free_node(thread_index, head);
+
+            return number;
+        }
+
+        // returns the surplus of the free nodes to the allocator, at most
+        // target nodes are kept per bucket besides the preallocated slab;
+        // the nodes a concurrent reader may see are freed by a later call
+        uint64_t trim(uint64_t target)
+        {
+            static_assert(
+                trimming_type::ENABLED,
+                "trim needs a trimming policy, e.g. quiescent_trimming"
+            );
+            return trim(get_thread_index(), target, true);
+        }
+
+        // the free nodes in the bucket holder, without the magazines
+        uint64_t get_nodes_count(uint64_t bucket_index) const
+        {
+            static_assert(
+                statistics_type::ENABLED,
+                "get_nodes_count needs a statistics policy"
+            );
+            return m_statistics.get_free_nodes(bucket_index);
+        }
+        // for sizing init_nodes_number and max_nodes_number from the load
+        typename statistics_type::snapshot_type get_statistics() const
+        {
+            static_assert(
+                statistics_type::ENABLED,
+                "get_statistics needs a statistics policy"
+            );
+            return m_statistics.snapshot();
+        }
+
+    private:
+        // the magazine first, then the own bucket, then a new node within
+        // the bucket limit, then the nodes of the other buckets
+        tagged_type get_free_node(uint64_t thread_index, value_type const& value)
+        {
+            tagged_type new_node = m_magazines.get_node(thread_index);
+            if (!tptrs_type::is_null(new_node))
+            {
+                tptrs_type::template get_pointer<node_type*>(
+                    new_node
+                )->value = value;
+                m_statistics.add(thread_index, statistics_type::MAGAZINE_HITS);
+                return new_node;
+            }
+
+            uint64_t retries = 0;
             uint64_t bucket_index =
-                m_thread_data[get_thread_index()].bucket_index++ % BUCKETS_NUMBER;
+                m_thread_data[thread_index].bucket_index++ % BUCKETS_NUMBER;
             auto& bucket = m_buckets[bucket_index];
-            bucket.nodes_holder.save_node(static_cast<node_type*>(current_head));
+            new_node = bucket.nodes_holder.get_node(value, &retries);
+            m_statistics.add(
+                thread_index, statistics_type::GET_RETRIES, retries
+            );
+            if (!tptrs_type::is_null(new_node))
+            {
+                m_statistics.add_free(thread_index, bucket_index, -1);
+                m_statistics.add(thread_index, statistics_type::BUCKET_HITS);
+                return new_node;
+            }
 
+            if(bucket.current_nodes_number.fetch_add(
+                    1, std::memory_order_acq_rel
+               ) < bucket.max_nodes_number
+            ) {
+                try {
+                    new_node = tptrs_type::set(
+                        m_allocator_holder.allocate_and_construct(value), 0
+                    );
+                    m_statistics.add(
+                        thread_index, statistics_type::ALLOCATIONS
+                    );
+                    return new_node;
+                } catch(...) {
+                    bucket.current_nodes_number.fetch_sub(
+                        1, std::memory_order_seq_cst
+                    );
+                    throw;
+                }
+            }
+            bucket.current_nodes_number.fetch_sub(
+                1, std::memory_order_relaxed
+            );
+            m_statistics.add(thread_index, statistics_type::REJECTIONS);
+            // a full magazine of the depot is the last reachable one
+            if (save_depot_magazine(thread_index, bucket_index))
+            {
+                new_node = bucket.nodes_holder.get_node(value, &retries);
+                if (!tptrs_type::is_null(new_node))
+                {
+                    m_statistics.add_free(thread_index, bucket_index, -1);
+                    m_statistics.add(thread_index, statistics_type::BUCKET_HITS);
+                    return new_node;
+                }
+            }
+            for (uint64_t i = 1; i < BUCKETS_NUMBER; ++i)
+            {
+                uint64_t steal_index = (bucket_index + i) % BUCKETS_NUMBER;
+                retries = 0;
+                new_node = m_buckets[steal_index].nodes_holder.get_node(
+                    value, &retries
+                );
+                m_statistics.add(
+                    thread_index, statistics_type::GET_RETRIES, retries
+                );
+                if (!tptrs_type::is_null(new_node))
+                {
+                    m_statistics.add_free(thread_index, steal_index, -1);
+                    m_statistics.add(thread_index, statistics_type::STEALS);
+                    break;
+                }
+            }
+            return new_node;
+        }
+        void save_free_node(uint64_t thread_index, tagged_type ptr)
+        {
+            if(!m_magazines.save_node(thread_index, ptr))
+            {
+                uint64_t retries = 0;
+                uint64_t bucket_index =
+                    m_thread_data[thread_index].bucket_index++ % BUCKETS_NUMBER;
+                m_buckets[bucket_index].nodes_holder.save_node(ptr, &retries);
+                m_statistics.add_free(thread_index, bucket_index, 1);
+                m_statistics.add(
+                    thread_index, statistics_type::SAVE_RETRIES, retries
+                );
+            }
+            if(m_trimming.need_trim(thread_index))
+                trim(thread_index, trimming_type::WATERMARK, false);
+        }
+        void save_free_nodes(
+            uint64_t thread_index,
+            uint64_t bucket_index,
+            tagged_type const* nodes,
+            uint64_t number
+        )
+        {
+            for (auto ptr = nodes; ptr != nodes + number; ++ptr)
+            {
+                uint64_t retries = 0;
+                m_buckets[bucket_index].nodes_holder.save_node(*ptr, &retries);
+                m_statistics.add(
+                    thread_index, statistics_type::SAVE_RETRIES, retries
+                );
+            }
+            m_statistics.add_free(thread_index, bucket_index, number);
+        }
+        // the whole depot under its lock, not for the operations
+        void save_depot(uint64_t thread_index, uint64_t bucket_index)
+        {
+            std::vector<tagged_type> nodes;
+            m_magazines.take_depot(nodes);
+            save_free_nodes(
+                thread_index, bucket_index, nodes.data(), nodes.size()
+            );
+        }
+        // one full magazine of the depot if its lock is free,
+        // false otherwise or if the depot was empty
+        bool save_depot_magazine(uint64_t thread_index, uint64_t bucket_index)
+        {
+            typename magazines_type::magazine_type magazine;
+            if (!m_magazines.take_magazine(magazine)) return false;
+            save_free_nodes(
+                thread_index, bucket_index, magazine.nodes.data(), magazine.size
+            );
             return true;
         }
+        // by the exiting thread, nobody else could take its nodes
+        void release_magazines(uint64_t thread_index)
+        {
+            trimming_guard_type guard(m_trimming, thread_index);
+            std::vector<tagged_type> nodes;
+            m_magazines.flush(thread_index, nodes);
+            save_free_nodes(
+                thread_index,
+                m_thread_data[thread_index].bucket_index % BUCKETS_NUMBER,
+                nodes.data(),
+                nodes.size()
+            );
+        }
 
-        uint64_t get_nodes_count(uint64_t bucket_index) const
+        uint64_t trim(uint64_t thread_index, uint64_t target, bool wait)
         {
-            return m_buckets[bucket_index].nodes_holder.get_nodes_count();
+            trimming_guard_type guard(m_trimming, thread_index);
+            return m_trimming.trim(
+                thread_index,
+                [this, thread_index, target] (std::vector<void*>& nodes) {
+                    detach_surplus(thread_index, target, nodes);
+                },
+                [this, thread_index] (void* ptr) {
+                    free_trimmed_node(thread_index, ptr);
+                },
+                wait
+            );
+        }
+        // only the surplus above target is popped from a bucket by the
+        // lock-free get_node, so the bucket never looks empty meanwhile;
+        // the slab nodes met on the way are saved back. The depot is
+        // counted in first, the nodes in the magazines are never trimmed
+        void detach_surplus(
+            uint64_t thread_index,
+            uint64_t target,
+            std::vector<void*>& nodes
+        )
+        {
+            save_depot(
+                thread_index,
+                m_thread_data[thread_index].bucket_index % BUCKETS_NUMBER
+            );
+            std::vector<tagged_type> slab_nodes;
+            for (uint64_t i = 0; i < BUCKETS_NUMBER; ++i)
+            {
+                // the sum of the deltas may be transiently negative
+                auto count =
+                    static_cast<int64_t>(m_statistics.get_free_nodes(i));
+                uint64_t kept_number = m_slabs[i].second - m_slabs[i].first;
+                kept_number += std::min(target, INFINITE_NUMBER - kept_number);
+                if (count <= 0 || static_cast<uint64_t>(count) <= kept_number)
+                    continue;
+
+                // the slab nodes are popped once at most, so the work is
+                // bounded by the surplus and the slab size
+                auto& nodes_holder = m_buckets[i].nodes_holder;
+                uint64_t surplus = count - kept_number;
+                for (uint64_t j = count; surplus && j; --j)
+                {
+                    tagged_type ptr = nodes_holder.get_node();
+                    if (tptrs_type::is_null(ptr)) break;
+                    auto node_ptr =
+                        tptrs_type::template get_pointer<node_type*>(ptr);
+                    if (is_slab_node(node_ptr)) slab_nodes.push_back(ptr);
+                    else {
+                        m_statistics.add_free(thread_index, i, -1);
+                        nodes.push_back(node_ptr);
+                        --surplus;
+                    }
+                }
+                for (auto ptr : slab_nodes) nodes_holder.save_node(ptr);
+                slab_nodes.clear();
+            }
+        }
+        // the nodes linked from ptr up to a null next
+        void free_nodes(node_type* ptr)
+        {
+            while (ptr)
+            {
+                auto next = tptrs_type::template get_pointer<node_type*>(
+                    ptr->next.load(std::memory_order_relaxed), true
+                );
+                if (!is_slab_node(ptr))
+                    m_allocator_holder.destroy_and_deallocate(ptr);
+                ptr = next;
+            }
+        }
+        bool is_slab_node(node_type* ptr) const
+        {
+            for (auto& slab : m_slabs)
+            {
+                if (ptr >= slab.first && ptr < slab.second) return true;
+            }
+            return false;
+        }
+        // the nodes limit is shared, any bucket gives its count back
+        void free_trimmed_node(uint64_t thread_index, void* ptr)
+        {
+            m_statistics.add(thread_index, statistics_type::TRIMMED);
+            m_allocator_holder.destroy_and_deallocate(
+                static_cast<node_type*>(ptr)
+            );
+            for (auto& bucket : m_buckets)
+            {
+                auto& nodes_number = bucket.current_nodes_number;
+                auto number = nodes_number.load(std::memory_order_relaxed);
+                while (number && !nodes_number.compare_exchange_weak(
+                    number, number - 1, std::memory_order_relaxed
+                ));
+                if (number) break;
+            }
         }
 
     private:
-        std::atomic<uint64_t> m_thread_index_calc;
         std::array<bucket_type, BUCKETS_NUMBER> m_buckets;
         char padding1[128 - sizeof m_buckets];
         std::array<perthread_data_type, MAX_THREADS_NUMBER> m_thread_data;
         allocator_holder_type m_allocator_holder;
         char padding2[128 - sizeof m_allocator_holder];
-        std::atomic<tagged_pointer> m_head;
+        typename tptrs_type::atomic_type m_head;
         char padding3[128 - sizeof m_head];
         backoff_strategy_type m_backoff;
+        elimination_type m_elimination;
+        magazines_type m_magazines;
+        trimming_type m_trimming;
+        statistics_type m_statistics;
+        std::array<std::pair<node_type*, node_type*>, BUCKETS_NUMBER> m_slabs{};
+        thread_registry<MAX_THREADS_NUMBER> m_registry;
     };
     //
 }